@@ -110,6 +110,15 @@
  * element. order: Finger 1, 2, 3 */
 #define SYNAPTICS_PROP_CLICK_ACTION "Synaptics Click Action"
 
+/* 8 bit, up to MAX_GESTURE values (see synaptics.h), 0 disables an
+ * element. order: 3 finger swipe left, right, up, down, 4 finger swipe
+ * left, right, up, down, pinch in, out, rotate clockwise, counter-clockwise */
+#define SYNAPTICS_PROP_GESTURE_ACTION "Synaptics Gesture Action"
+
+/* 8 bit, up to MAX_GESTURE values, X keycodes in the order of
+ * SYNAPTICS_PROP_GESTURE_ACTION, 0 disables an element */
+#define SYNAPTICS_PROP_GESTURE_KEYS "Synaptics Gesture Keys"
+
 /* 8 bit (BOOL) */
 #define SYNAPTICS_PROP_CIRCULAR_SCROLLING "Synaptics Circular Scrolling"
 
@@ -130,9 +139,15 @@
 /* 32 bit, 2 values, width, z */
 #define SYNAPTICS_PROP_PALM_DIMENSIONS "Synaptics Palm Dimensions"
 
+/* 32 bit, 2 values, thumb, palm; minimum touch major, 0 disables */
+#define SYNAPTICS_PROP_PALM_TOUCH_MAJOR "Synaptics Palm Touch Major"
+
 /* FLOAT, 2 values, speed, friction */
 #define SYNAPTICS_PROP_COASTING_SPEED "Synaptics Coasting Speed"
 
+/* FLOAT, 1 value, time constant of the coasting slowdown in ms */
+#define SYNAPTICS_PROP_COASTING_DECAY "Synaptics Coasting Decay"
+
 /* 32 bit, 2 values, min, max */
 #define SYNAPTICS_PROP_PRESSURE_MOTION "Synaptics Pressure Motion"
 
@@ -161,4 +176,18 @@
 /* 32 Bit Integer, 2 values, horizontal hysteresis, vertical hysteresis */
 #define SYNAPTICS_PROP_NOISE_CANCELLATION "Synaptics Noise Cancellation"
 
+/* FLOAT, 0 or 3 to 32 values, max velocity, accel factors from velocity 0 to
+ * max velocity. 0 values selects the built-in curve */
+#define SYNAPTICS_PROP_ACCEL_CURVE "Synaptics Acceleration Curve"
+
+/* FLOAT, 2 values, horizon (ms), damping */
+#define SYNAPTICS_PROP_PREDICTION "Synaptics Prediction"
+
+/* 32 bit, 1 value, motion events per second, 0 disables resampling */
+#define SYNAPTICS_PROP_RESAMPLE_RATE "Synaptics Resample Rate"
+
+/* 32 bit, 8 values, right button area left, right, top, bottom, middle
+ * button area left, right, top, bottom; 0 leaves an edge open */
+#define SYNAPTICS_PROP_SOFTBUTTON_AREAS "Synaptics Soft Button Areas"
+
 #endif /* _SYNAPTICS_PROPERTIES_H_ */
@@ -46,6 +46,22 @@ typedef enum {
     MAX_CLICK
 } ClickFingerEvent;
 
+typedef enum {
+    SWIPE3_LEFT = 0,			    /* Three finger swipe */
+    SWIPE3_RIGHT,
+    SWIPE3_UP,
+    SWIPE3_DOWN,
+    SWIPE4_LEFT,			    /* Four finger swipe */
+    SWIPE4_RIGHT,
+    SWIPE4_UP,
+    SWIPE4_DOWN,
+    PINCH_IN,				    /* Two fingers closing */
+    PINCH_OUT,				    /* Two fingers spreading */
+    ROTATE_CW,				    /* Two fingers turning clockwise */
+    ROTATE_CCW,				    /* Two fingers turning counter-clockwise */
+    MAX_GESTURE
+} GestureEvent;
+
 #define SYN_MAX_BUTTONS 12		    /* Max number of mouse buttons */
 
 #define SHM_SYNAPTICS 23947
@@ -153,7 +153,6 @@ ALPS_process_packet(unsigned char *packet, struct SynapticsHwState *hw)
 {
     int x = 0, y = 0, z = 0;
     int left = 0, right = 0, middle = 0;
-    int i;
 
     x = (packet[1] & 0x7f) | ((packet[2] & 0x78) << (7-3));
     y = (packet[4] & 0x7f) | ((packet[3] & 0x70) << (7-4));
@@ -168,8 +167,7 @@ ALPS_process_packet(unsigned char *packet, struct SynapticsHwState *hw)
     /* Handle normal packets */
     hw->x = hw->y = hw->z = hw->numFingers = hw->fingerWidth = 0;
     hw->left = hw->right = hw->up = hw->down = hw->middle = FALSE;
-    for (i = 0; i < 8; i++)
-	hw->multi[i] = FALSE;
+    hw->multi = 0;
 
     if (z > 0) {
 	hw->x = x;
@@ -207,7 +205,7 @@ ALPS_process_packet(unsigned char *packet, struct SynapticsHwState *hw)
 static Bool
 ALPSReadHwState(InputInfoPtr pInfo,
 		struct SynapticsProtocolOperations *proto_ops,
-		struct CommData *comm, struct SynapticsHwState *hwRet)
+		struct CommData *comm)
 {
     unsigned char *buf = comm->protoBuf;
     struct SynapticsHwState *hw = &(comm->hwState);
@@ -217,7 +215,6 @@ ALPSReadHwState(InputInfoPtr pInfo,
 
     ALPS_process_packet(buf, hw);
 
-    *hwRet = *hw;
     return TRUE;
 }
 
@@ -0,0 +1,78 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* every allocation is aligned for any type */
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct ArenaBlock {
+	ArenaBlock *next;
+	size_t size;		/* bytes in data[] */
+	size_t used;
+	union {
+		long double ld;
+		void *p;
+	} data[];
+};
+
+void arena_init(Arena *a, size_t block_size)
+{
+	a->blocks = NULL;
+	a->block_size = ARENA_ROUND(block_size);
+	a->sealed = 0;
+	a->refused = 0;
+}
+
+/* room for an allocation of size bytes in the first block, if there is
+ * none yet */
+void arena_reserve(Arena *a, size_t size)
+{
+	if (!a->blocks)
+		a->block_size += ARENA_ROUND(size);
+}
+
+/* size bytes, zeroed; NULL if out of memory or sealed */
+void *arena_alloc(Arena *a, size_t size)
+{
+	ArenaBlock *b = a->blocks;
+	void *p;
+
+	if (a->sealed) {
+		a->refused++;
+		return NULL;
+	}
+
+	size = ARENA_ROUND(size);
+	if (!b || b->size - b->used < size) {
+		size_t bsize = size > a->block_size ? size : a->block_size;
+
+		b = malloc(sizeof(ArenaBlock) + bsize);
+		if (!b)
+			return NULL;
+		b->next = a->blocks;
+		b->size = bsize;
+		b->used = 0;
+		a->blocks = b;
+	}
+
+	p = (char *)b->data + b->used;
+	b->used += size;
+	memset(p, 0, size);
+	return p;
+}
+
+void arena_seal(Arena *a, int sealed)
+{
+	a->sealed = sealed;
+}
+
+void arena_release(Arena *a)
+{
+	while (a->blocks) {
+		ArenaBlock *b = a->blocks;
+
+		a->blocks = b->next;
+		free(b);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Per-device memory arena. Everything the driver allocates for a device is
+ * carved out of it during setup and released in one go when the device
+ * goes away; nothing is freed individually. The first block is sized by
+ * the reservations made before the first allocation, further blocks are
+ * chained as needed while setting up. Once sealed, for as long as the
+ * device is on, the arena refuses allocations and counts them instead.
+ * That only covers the arena itself: malloc() and friends called from the
+ * event path are caught by test/replay, not here.
+ */
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+	ArenaBlock *blocks;	/* newest first, allocations come from the head */
+	size_t block_size;	/* size of new blocks unless a request is larger */
+	int sealed;		/* the device is on, allocations are refused */
+	unsigned long refused;	/* allocations attempted while sealed */
+} Arena;
+
+void arena_init(Arena *a, size_t block_size);
+void arena_reserve(Arena *a, size_t size);
+void *arena_alloc(Arena *a, size_t size);
+void arena_seal(Arena *a, int sealed);
+void arena_release(Arena *a);
+
+#endif /*ARENA_H*/
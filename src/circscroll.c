@@ -0,0 +1,70 @@
+#include "circscroll.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#ifndef M_PI_2
+#define M_PI_2 1.57079632679489661923
+#endif
+
+/*
+ * atan2 through a minimax polynomial for atan on [0, 1]. The absolute
+ * error stays below 1e-5 rad, far under any sensible CircScrollDelta.
+ * Used for angle() with --enable-fast-atan2.
+ */
+double circ_fast_atan2(double y, double x)
+{
+	double ax = fabs(x), ay = fabs(y);
+	double r, r2, a;
+
+	if (ax == 0 && ay == 0)
+		return 0;
+
+	r = (ay > ax) ? ax / ay : ay / ax;
+	r2 = r * r;
+	a = r * (0.99997726 + r2 * (-0.33262347 + r2 * (0.19354346 +
+		r2 * (-0.11643287 + r2 * (0.05265332 + r2 * -0.01172120)))));
+
+	if (ay > ax)
+		a = M_PI_2 - a;
+	if (x < 0)
+		a = M_PI - a;
+	return (y < 0) ? -a : a;
+}
+
+/* a2 - a1, wrapped into [-pi, pi] */
+double circ_diff(double a1, double a2)
+{
+	double da = fmod(a2 - a1, 2 * M_PI);
+
+	if (da < 0)
+		da += 2 * M_PI;
+	if (da > M_PI)
+		da -= 2 * M_PI;
+	return da;
+}
+
+/*
+ * Whole steps of delta radians turned from *scroll_a to a, positive
+ * counter clockwise. Up to one step is left over, so a finger that turns
+ * back and forth around a step position doesn't scroll. *scroll_a moves on
+ * by the steps taken. inv_delta is 1 / delta.
+ */
+int circ_steps(double *scroll_a, double a, double delta, double inv_delta)
+{
+	double steps = circ_diff(*scroll_a, a) * inv_delta;
+	int n = 0;
+
+	if (steps > 1)
+		n = (int)ceil(steps) - 1;
+	else if (steps < -1)
+		n = (int)floor(steps) + 1;
+
+	*scroll_a += n * delta;
+	if (*scroll_a > M_PI)
+		*scroll_a -= 2 * M_PI;
+	else if (*scroll_a < -M_PI)
+		*scroll_a += 2 * M_PI;
+	return n;
+}
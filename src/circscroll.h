@@ -0,0 +1,14 @@
+#ifndef CIRCSCROLL_H
+#define CIRCSCROLL_H
+
+/*
+ * Angle arithmetic for circular scrolling. The angle of the finger around
+ * the pad center is taken once per frame and the number of whole steps
+ * turned past the last step position is computed from it directly.
+ */
+
+double circ_fast_atan2(double y, double x);
+double circ_diff(double a1, double a2);
+int circ_steps(double *scroll_a, double a, double delta, double inv_delta);
+
+#endif /*CIRCSCROLL_H*/
@@ -37,6 +37,7 @@
 #include <dirent.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include "synproto.h"
 #include "synaptics.h"
 #include "synapticsstr.h"
@@ -58,10 +59,6 @@ YOLOG_STATIC_INIT("eventcomm.c", YOLOG_WARN);
 #define TEST_BIT(bit, array) ((array[LONG(bit)] >> OFF(bit)) & 1)
 
 #define SLOT_INACTIVE (uint32_t)-1
-#define SCROLL_INACTIVE -1
-#define scroll_2f_active(ecp) \
-	((ecp->active_touches == 2 && ecp->depressed == FALSE ) \
-			|| (ecp->active_touches == 3 && ecp->depressed == TRUE))
 
 /*****************************************************************************
  *	Function Definitions
@@ -73,26 +70,44 @@ EventDevicePreInitHook(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
     SynapticsPrivate *priv = (SynapticsPrivate *)pInfo->private;
     EventcommPrivate *ecpriv;
     struct input_absinfo abs;
-    int rc;
+    unsigned long absbits[NBITS(ABS_MAX)] = {0};
+    int num_touches = 10, num_mt_axes = 0;
+    int i, rc;
+
+    SYSCALL(rc = ioctl(pInfo->fd, EVIOCGABS(ABS_MT_SLOT), &abs));
+    if (rc >= 0 && abs.maximum > 0)
+        num_touches = abs.maximum + 1;
+    else {
+        SYSCALL(rc = ioctl(pInfo->fd, EVIOCGABS(ABS_MT_TRACKING_ID), &abs));
+        if (rc >= 0 && abs.maximum > 0)
+            num_touches = abs.maximum + 1;
+    }
 
-    priv->proto_data = calloc(1, sizeof(EventcommPrivate));
+    SYSCALL(rc = ioctl(pInfo->fd, EVIOCGBIT(EV_ABS, sizeof(absbits)), absbits));
+    if (rc >= 0)
+        for (i = ABS_MT_TOUCH_MAJOR; i <= ABS_MT_PRESSURE; i++)
+            if (TEST_BIT(i, absbits))
+                num_mt_axes++;
+
+    /* the private data and, if there are touch axes, the slot table of
+     * EventDeviceInitHook() go in the first arena block */
+    arena_reserve(&priv->arena, sizeof(EventcommPrivate));
+    if (num_mt_axes)
+        arena_reserve(&priv->arena, num_touches * sizeof(SynapticsFinger));
+
+    priv->proto_data = arena_alloc(&priv->arena, sizeof(EventcommPrivate));
     if (!priv->proto_data)
         return !Success;
 
     ecpriv = priv->proto_data;
     ecpriv->need_grab = TRUE;
-    ecpriv->num_touches = 10;
+    ecpriv->num_touches = num_touches;
     ecpriv->cur_slot = -1;
+    ecpriv->use_grail = xf86SetBoolOption(pInfo->options, "GrailGestures", FALSE);
+
+    if (ecpriv->use_grail && GrailInit(pInfo))
+        ecpriv->use_grail = FALSE;
 
-    SYSCALL(rc = ioctl(pInfo->fd, EVIOCGABS(ABS_MT_SLOT), &abs));
-    if (rc >= 0 && abs.maximum > 0)
-        ecpriv->num_touches = abs.maximum + 1;
-    else {
-        SYSCALL(rc = ioctl(pInfo->fd, EVIOCGABS(ABS_MT_TRACKING_ID), &abs));
-        if (rc >= 0 && abs.maximum > 0)
-            ecpriv->num_touches = abs.maximum + 1;
-    }
-        
     return Success;
 }
 
@@ -107,11 +122,14 @@ EventDeviceInitHook(DeviceIntPtr dev)
     if (!priv->has_touch)
         return Success;
 
-    ecpriv->slot_info = malloc(ecpriv->num_touches * sizeof(SynapticsFinger));
+    /* kept in the arena over DeviceClose, for the next DeviceInit */
+    if (!ecpriv->slot_info)
+        ecpriv->slot_info = arena_alloc(&priv->arena,
+                                        ecpriv->num_touches * sizeof(SynapticsFinger));
     if (!ecpriv->slot_info)
         goto err;
 
-    memset(ecpriv->slot_info, 0, sizeof(SynapticsFinger));
+    memset(ecpriv->slot_info, 0, ecpriv->num_touches * sizeof(SynapticsFinger));
 
     for (i = 0; i < ecpriv->num_touches; i++) {
         ecpriv->slot_info[i].tracking_id = -1;
@@ -164,8 +182,6 @@ EventDeviceInitHook(DeviceIntPtr dev)
     return Success;
 
 err:
-    free(ecpriv->slot_info);
-    ecpriv->slot_info = NULL;
     free(ecpriv->cur_vals);
     ecpriv->cur_vals = NULL;
     free(ecpriv->touch_mask);
@@ -199,7 +215,8 @@ EventDeviceOnHook(InputInfoPtr pInfo, SynapticsParameters *para)
             ecpriv->cur_slot = abs.value;
     }
 
-    GrailOpen(pInfo);
+    if (ecpriv->use_grail)
+        GrailOpen(pInfo);
 }
 
 static void
@@ -215,11 +232,11 @@ EventDeviceCloseHook(DeviceIntPtr dev)
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
     EventcommPrivate *ecpriv = (EventcommPrivate *)priv->proto_data;
 
-    free(ecpriv->slot_info);
+    /* the private data and slots belong to the arena */
     free(ecpriv->cur_vals);
+    ecpriv->cur_vals = NULL;
     free(ecpriv->touch_mask);
-    free(ecpriv);
-    priv->proto_data = NULL;
+    ecpriv->touch_mask = NULL;
 }
 
 static Bool
@@ -438,12 +455,19 @@ event_query_axis_ranges(InputInfoPtr pInfo)
 
         ecpriv->mt_axis_map[i - ABS_MT_TOUCH_MAJOR] = ecpriv->num_mt_axes++;
         priv->has_touch = TRUE;
+
+        if (i == ABS_MT_TOUCH_MAJOR) {
+            xf86Msg(X_PROBED, "%s: touch major range %d - %d\n", pInfo->name,
+                    ecpriv->absinfo[i].minimum, ecpriv->absinfo[i].maximum);
+            priv->min_major = ecpriv->absinfo[i].minimum;
+            priv->max_major = ecpriv->absinfo[i].maximum;
+        }
     }
 
     if (priv->has_touch) {
         /* We don't support SemiMultitouch devices yet. */
         SYSCALL(rc = ioctl(pInfo->fd, EVIOCGPROP(sizeof(prop)), &prop));
-        if (rc >= 0 && (prop & INPUT_PROP_SEMI_MT))
+        if (rc >= 0 && BitIsOn(&prop, INPUT_PROP_SEMI_MT))
             ecpriv->semi_mt = TRUE;
         else
             ecpriv->semi_mt = FALSE;
@@ -534,7 +558,7 @@ ProcessTouch(InputInfoPtr pInfo, SynapticsPrivate *priv)
 }
 
 int GDB_watchpoint_hinter = 0;
-static void ProcessPosition(EventcommPrivate *ecpriv,
+static void ProcessPosition(SynapticsPrivate *priv, EventcommPrivate *ecpriv,
 		const struct input_event *ev,
 		struct SynapticsHwState *hw, SynapticsFinger *slotp)
 {
@@ -560,9 +584,24 @@ static void ProcessPosition(EventcommPrivate *ecpriv,
 
 	char *strax = (ev->code == ABS_MT_POSITION_X) ? "X" : "Y"; //debug stuff
 
-	if(ecpriv->cur_slot == ecpriv->pressing_slot
+	/*
+	 * Whether a new contact rests in the button band depends on where it
+	 * lands, so its position is held back until both axes are in.
+	 */
+	if (slotp->landing) {
+		slotp->landing &= ~(1 << m);
+		if (slotp->landing)
+			return;
+		slotp->resting = get_button_zone(priv, slotp->metric[SYNMETRIC_X],
+						 slotp->metric[SYNMETRIC_Y]) > 0;
+	}
+
+	if((ecpriv->cur_slot == ecpriv->pressing_slot
 			&& ecpriv->depressed
 			&& ecpriv->active_touches >= 2)
+		|| slotp->rejected
+		|| (slotp->resting && ecpriv->last_sender >= 0
+			&& ecpriv->last_sender != ecpriv->cur_slot))
 	{
     	yolog_debug("S=%2d %s=%6d. BLOCKED", ecpriv->cur_slot, strax, ev->value);
     	return;
@@ -585,27 +624,186 @@ static void ProcessPosition(EventcommPrivate *ecpriv,
 	ecpriv->last_sender = ecpriv->cur_slot;
 
 	*posptr = ev->value;
+}
+
+/*
+ * The contact that most likely pressed the clickpad down: the lowest one
+ * inside the button band, or -1 if none is.
+ */
+static int
+ButtonZoneSlot(SynapticsPrivate *priv, EventcommPrivate *ecpriv)
+{
+	int slot = -1;
+	int i;
+
+	if (!priv->cp->has_button_zones)
+		return -1;
+
+	for (i = 0; i < ecpriv->num_touches; i++) {
+		SynapticsFinger *f = &ecpriv->slot_info[i];
+
+		if (f->tracking_id == SLOT_INACTIVE ||
+		    !get_button_zone(priv, f->metric[SYNMETRIC_X], f->metric[SYNMETRIC_Y]))
+			continue;
+		if (slot < 0 || f->metric[SYNMETRIC_Y] > ecpriv->slot_info[slot].metric[SYNMETRIC_Y])
+			slot = i;
+	}
+	return slot;
+}
 
-	if(scroll_2f_active(ecpriv)) {
-		/*If we have two finger scrolling on, set the fingers.*/
-		if(ecpriv->first_2f_scrollid == SCROLL_INACTIVE) {
-			ecpriv->first_2f_scrollid = ecpriv->cur_slot;
-			hw->scroll_fingers[0] = slotp;
-			hw->scroll_fingers[1] = NULL;
-			ecpriv->second_2f_scrollid = SCROLL_INACTIVE;
-		} else if (ecpriv->second_2f_scrollid == SCROLL_INACTIVE &&
-				ecpriv->first_2f_scrollid != ecpriv->cur_slot) {
-			ecpriv->second_2f_scrollid = ecpriv->cur_slot;
-			hw->scroll_fingers[1] = slotp;
+#define CONTACT_CLASS_FRAMES 3		/* reports a classified contact must look different to change class */
+#define CONTACT_THUMB_RELEASE 0.8	/* share of the thumb threshold a thumb must drop below */
+
+/*
+ * Sort the contacts into fingers, thumbs and palms by their touch major
+ * axis. A palm stays one until it is lifted and is always rejected; a thumb
+ * is only rejected while a finger is down as well, so it can still point
+ * on its own. A contact resting in the clickpad button band is handled
+ * like a thumb. A new contact takes its class from its first report; after
+ * that it only changes class once it has looked like another one for
+ * CONTACT_CLASS_FRAMES reports. Returns the number of rejected contacts.
+ */
+static int
+ClassifyContacts(SynapticsPrivate *priv, EventcommPrivate *ecpriv)
+{
+	const SynapticsParameters *para = &priv->cp->para;
+	int fingers = 0, rejected = 0;
+	int i;
+
+	for (i = 0; i < ecpriv->num_touches; i++) {
+		SynapticsFinger *f = &ecpriv->slot_info[i];
+		SynapticsContactClass c = CONTACT_FINGER;
+
+		if (f->tracking_id == SLOT_INACTIVE) {
+			f->contact_class = CONTACT_FINGER;
+			f->class_frames = 0;
+			f->classified = FALSE;
+			f->resting = FALSE;
+			f->landing = 0;
+			continue;
 		}
-		int fidx = (ecpriv->cur_slot == ecpriv->first_2f_scrollid) ? 0 : 1;
-		hw->scroll_pass[m][fidx] = TRUE;
-	} else {
-		memset(hw->scroll_pass, 0, sizeof(hw->scroll_pass));
 
-		/*2f-scroll off. Reset*/
-		ecpriv->first_2f_scrollid = ecpriv->second_2f_scrollid = SCROLL_INACTIVE;
-		hw->scroll_fingers[0] = hw->scroll_fingers[1] = NULL;
+		/* an axis of the landing position was the same as before */
+		if (f->landing) {
+			f->landing = 0;
+			f->resting = get_button_zone(priv, f->metric[SYNMETRIC_X],
+						     f->metric[SYNMETRIC_Y]) > 0;
+		}
+		/* once out of the button band a contact is a finger for good */
+		f->resting = f->resting &&
+			get_button_zone(priv, f->metric[SYNMETRIC_X], f->metric[SYNMETRIC_Y]);
+
+		if (!para->palm_detect) {
+			f->contact_class = CONTACT_FINGER;
+			f->class_frames = 0;
+			f->classified = TRUE;
+			fingers += !f->resting;
+			continue;
+		}
+
+		if (f->contact_class == CONTACT_PALM ||
+		    (para->palm_min_major > 0 && f->touch_major >= para->palm_min_major))
+			c = CONTACT_PALM;
+		else if (para->thumb_min_major > 0 &&
+			 (f->touch_major >= para->thumb_min_major ||
+			  (f->contact_class == CONTACT_THUMB &&
+			   f->touch_major >= para->thumb_min_major * CONTACT_THUMB_RELEASE)))
+			c = CONTACT_THUMB;
+
+		if (!f->classified) {
+			if (c != CONTACT_FINGER)
+				yolog_debug("S=%2d major=%d lands as class %d", i,
+					    f->touch_major, c);
+			f->contact_class = c;
+			f->class_frames = 0;
+			f->classified = TRUE;
+		} else if (c == f->contact_class) {
+			f->class_frames = 0;
+		} else if (++f->class_frames >= CONTACT_CLASS_FRAMES) {
+			yolog_debug("S=%2d major=%d class %d -> %d", i, f->touch_major,
+				    f->contact_class, c);
+			f->contact_class = c;
+			f->class_frames = 0;
+		}
+		fingers += (f->contact_class == CONTACT_FINGER && !f->resting);
+	}
+
+	for (i = 0; i < ecpriv->num_touches; i++) {
+		SynapticsFinger *f = &ecpriv->slot_info[i];
+
+		f->rejected = (f->tracking_id != SLOT_INACTIVE) &&
+			(f->contact_class == CONTACT_PALM ||
+			 ((f->contact_class == CONTACT_THUMB || f->resting) && fingers > 0));
+		rejected += f->rejected;
+	}
+	return rejected;
+}
+
+/*
+ * Summarise the contacts in one pass over the slot table. Slots without
+ * an update in this report still hold their last position. The rotation
+ * is taken over the contacts present in both this and the last report,
+ * about their centroids P (last) and Q (now); since
+ *   sum((p - P) x (q - Q)) = sum(p x q) - n (P x Q)
+ * and likewise for the dot product, plain sums are all that is needed.
+ * The loop is branch free so the compiler may vectorise it.
+ */
+static void
+UpdateContacts(EventcommPrivate *ecpriv, SynapticsContacts *c)
+{
+	double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0;
+	double nb = 0, px = 0, py = 0, qx = 0, qy = 0, cross = 0, dot = 0;
+	int moved = 0;
+	int i;
+
+	for (i = 0; i < ecpriv->num_touches; i++) {
+		SynapticsFinger *f = &ecpriv->slot_info[i];
+		double x = f->metric[SYNMETRIC_X], y = f->metric[SYNMETRIC_Y];
+		double lx = f->last_metric[SYNMETRIC_X], ly = f->last_metric[SYNMETRIC_Y];
+		int in = (f->tracking_id != SLOT_INACTIVE) & !f->rejected &
+				!(ecpriv->depressed && i == ecpriv->pressing_slot);
+		int both = in & f->has_last;
+
+		n += in;
+		sx += in * x;
+		sy += in * y;
+		sxx += in * x * x;
+		syy += in * y * y;
+
+		nb += both;
+		px += both * lx;
+		py += both * ly;
+		qx += both * x;
+		qy += both * y;
+		cross += both * (lx * y - ly * x);
+		dot += both * (lx * x + ly * y);
+
+		moved |= (in != f->has_last) | (in & ((x != lx) | (y != ly)));
+		f->last_metric[SYNMETRIC_X] = f->metric[SYNMETRIC_X];
+		f->last_metric[SYNMETRIC_Y] = f->metric[SYNMETRIC_Y];
+		f->has_last = in;
+	}
+
+	c->count = n;
+	c->moved = moved;
+	c->rotation = 0;
+	if (n == 0) {
+		c->centroid[SYNMETRIC_X] = c->centroid[SYNMETRIC_Y] = 0;
+		c->spread[SYNMETRIC_X] = c->spread[SYNMETRIC_Y] = 0;
+		return;
+	}
+
+	c->centroid[SYNMETRIC_X] = sx / n;
+	c->centroid[SYNMETRIC_Y] = sy / n;
+	c->spread[SYNMETRIC_X] = sqrt(fmax(sxx / n - sx * sx / (n * n), 0));
+	c->spread[SYNMETRIC_Y] = sqrt(fmax(syy / n - sy * sy / (n * n), 0));
+
+	if (nb >= 2) {
+		px /= nb; py /= nb;
+		qx /= nb; qy /= nb;
+		cross -= nb * (px * qy - py * qx);
+		dot -= nb * (px * qx + py * qy);
+		c->rotation = atan2(cross, dot);
 	}
 }
 
@@ -626,14 +824,13 @@ SynapticsReadEvent(InputInfoPtr pInfo, struct input_event *ev)
     }
     if (len <= 0)
     {
-        /* We use X_NONE here because it doesn't alloc */
         if (errno != EAGAIN)
-            xf86MsgVerb(X_NONE, 0, "%s: Read error %s\n", pInfo->name, strerror(errno));
+            SIGMSG(X_ERROR, 0, "%s: Read error, errno %d\n", pInfo->name, errno);
         rc = FALSE;
     } else if (use_grail)
         rc = FALSE;
     else if (len % sizeof(*ev)) {
-        xf86MsgVerb(X_NONE, 0, "%s: Read error, invalid number of bytes.", pInfo->name);
+        SIGMSG(X_ERROR, 0, "%s: Read error, invalid number of bytes.\n", pInfo->name);
         rc = FALSE;
     }
     return rc;
@@ -642,28 +839,19 @@ SynapticsReadEvent(InputInfoPtr pInfo, struct input_event *ev)
 
 Bool
 EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
-                  struct SynapticsHwState *hwRet, const struct input_event *ev)
+                  const struct input_event *ev)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *)pInfo->private;
     EventcommPrivate *ecpriv = (EventcommPrivate *)priv->proto_data;
-    SynapticsParameters *para = &priv->synpara;
-    struct SynapticsHwState *hw = &(comm->hwState);
+    const SynapticsParameters *para = &priv->cp->para;
+    struct SynapticsHwState *hw = &ecpriv->frame;
     Bool v;
     Bool ret = FALSE;
     SynapticsFinger *slotp;
     SynapticsFinger stack_dummy;
 
     if(hw->new_eventset) {
-    	/*Reset scroll data*/
     	hw->new_eventset = FALSE;
-    	memset(hw->scroll_pass, 0, sizeof(hw->scroll_pass));
-
-    	if(ecpriv->first_2f_scrollid == SCROLL_INACTIVE) {
-    		hw->scroll_fingers[0] = NULL;
-    	}
-    	if(ecpriv->second_2f_scrollid == SCROLL_INACTIVE) {
-    		hw->scroll_fingers[1] = NULL;
-    	}
     }
 
     if(ecpriv->cur_slot >= 0) {
@@ -676,8 +864,14 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
     switch (ev->type) {
     case EV_SYN:
         switch (ev->code) {
-        case SYN_REPORT:
+        case SYN_REPORT: {
+            int rejected = 0;
+
             ProcessTouch(pInfo, priv);
+            if (priv->has_touch) {
+                rejected = ClassifyContacts(priv, ecpriv);
+                UpdateContacts(ecpriv, &hw->contacts);
+            }
             if (priv->has_touch && ecpriv->active_touches < 2)
                 hw->numFingers = ecpriv->active_touches;
             else if (comm->oneFinger)
@@ -688,8 +882,15 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
                 hw->numFingers = 3;
             else
                 hw->numFingers = 0;
-            *hwRet = *hw;
+            hw->numFingers = hw->numFingers > rejected ? hw->numFingers - rejected : 0;
+            /* nothing but palms and thumbs on the pad reads as no touch */
+            if (rejected && rejected >= ecpriv->active_touches)
+                hw->z = 0;
+            else
+                hw->z = ecpriv->pressure;
             ret = TRUE;
+            break;
+        }
         }
     case EV_KEY:
         v = (ev->value ? TRUE : FALSE);
@@ -699,7 +900,11 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
             ecpriv->depressed = v;
             ecpriv->pressing_slot = ecpriv->cur_slot;
             if(v == TRUE) {
-            	hw->pressing_finger = slotp;
+            	int s = ButtonZoneSlot(priv, ecpriv);
+            	if (s >= 0)
+            		ecpriv->pressing_slot = s;
+            	hw->pressing_finger = (ecpriv->pressing_slot >= 0) ?
+            		&ecpriv->slot_info[ecpriv->pressing_slot] : NULL;
             } else {
             	hw->pressing_finger = NULL;
             }
@@ -716,29 +921,12 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
         case BTN_BACK:
             hw->down = v;
             break;
-        case BTN_0:
-            hw->multi[0] = v;
-            break;
-        case BTN_1:
-            hw->multi[1] = v;
-            break;
-        case BTN_2:
-            hw->multi[2] = v;
-            break;
-        case BTN_3:
-            hw->multi[3] = v;
-            break;
-        case BTN_4:
-            hw->multi[4] = v;
-            break;
-        case BTN_5:
-            hw->multi[5] = v;
-            break;
-        case BTN_6:
-            hw->multi[6] = v;
-            break;
-        case BTN_7:
-            hw->multi[7] = v;
+        case BTN_0: case BTN_1: case BTN_2: case BTN_3:
+        case BTN_4: case BTN_5: case BTN_6: case BTN_7:
+            if (v)
+                hw->multi |= 1 << (ev->code - BTN_0);
+            else
+                hw->multi &= ~(1 << (ev->code - BTN_0));
             break;
         case BTN_TOOL_FINGER:
             comm->oneFinger = v;
@@ -751,14 +939,14 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
             break;
         case BTN_TOUCH:
             if (!priv->has_pressure)
-                    hw->z = v ? para->finger_high + 1 : 0;
+                    ecpriv->pressure = v ? para->finger_high + 1 : 0;
             break;
         }
         break;
     case EV_ABS:
         switch (ev->code) {
         case ABS_PRESSURE:
-            hw->z = ev->value;
+            ecpriv->pressure = ev->value;
             break;
         case ABS_TOOL_WIDTH:
             hw->fingerWidth = ev->value;
@@ -778,13 +966,17 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
             {
                 if (slotp->tracking_id != SLOT_INACTIVE)
                 {
-                    xf86Msg(X_WARNING, "%s: Ignoring new tracking ID for "
-                            "existing touch.\n", pInfo->dev->name);
+                    SIGMSG(X_WARNING, 0, "%s: Ignoring new tracking ID for "
+                           "existing touch.\n", pInfo->dev->name);
                 }
                 else
                 {
                 	slotp->finger_id = ecpriv->cur_slot;
                 	slotp->tracking_id = ecpriv->next_tracking_id++;
+                	slotp->resting = FALSE;
+                	slotp->classified = FALSE;
+                	slotp->landing = priv->cp->has_button_zones ?
+                		(1 << SYNMETRIC_X) | (1 << SYNMETRIC_Y) : 0;
                     ecpriv->new_touch = TRUE;
                     valuator_mask_copy(ecpriv->touch_mask,
                                        ecpriv->cur_vals);
@@ -808,6 +1000,8 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
         case ABS_MT_PRESSURE:
             if (ecpriv->cur_slot >= 0)
             {
+                if (ev->code == ABS_MT_TOUCH_MAJOR)
+                    slotp->touch_major = ev->value;
                 valuator_mask_set(ecpriv->touch_mask,
                                   ecpriv->mt_axis_map[ev->code - ABS_MT_TOUCH_MAJOR],
                                   ev->value);
@@ -821,7 +1015,7 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
         	if(ecpriv->cur_slot < 0) {
         		break;
         	}
-        	ProcessPosition(ecpriv, ev, hw, slotp);
+        	ProcessPosition(priv, ecpriv, ev, hw, slotp);
         }
 
     } /*switch(ev->code)*/
@@ -830,6 +1024,7 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
     if(ret == TRUE) {
     	/*Signal that the next update of the hw struct is part of a new eventset*/
     	hw->new_eventset = TRUE;
+    	comm->hwState = *hw;
     }
     return ret;
 }
@@ -837,14 +1032,14 @@ EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
 static Bool
 EventReadHwState(InputInfoPtr pInfo,
 		 struct SynapticsProtocolOperations *proto_ops,
-		 struct CommData *comm, struct SynapticsHwState *hwRet)
+		 struct CommData *comm)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *)pInfo->private;
     EventcommPrivate *ecpriv = (EventcommPrivate *)priv->proto_data;
     struct input_event ev;
 
     while (SynapticsReadEvent(pInfo, &ev)) {
-        if (EventProcessEvent(pInfo, comm, hwRet, &ev) && !ecpriv->grail)
+        if (EventProcessEvent(pInfo, comm, &ev) && !ecpriv->grail)
             return TRUE;
     }
     return FALSE;
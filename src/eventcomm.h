@@ -71,6 +71,7 @@ typedef struct {
     int num_touches;
     struct mtdev *mtdev;
     struct grail *grail;
+    struct grail *grail_store;	/*Allocated at PreInit, grail points here while open*/
     int active_touches;
     Bool semi_mt;
     int min_x;
@@ -78,18 +79,20 @@ typedef struct {
     int min_y;
     int max_y;
 
+    int pressure;		/*Last reported pressure, hw->z unless palms are rejected*/
+    struct SynapticsHwState frame; /*The frame being built, published to comm->hwState at SYN_REPORT*/
+
     /*State data for clickpads*/
     Bool depressed;
     int pressing_slot;
     int last_sender;
 
-    int first_2f_scrollid;
-    int second_2f_scrollid;
+    Bool use_grail;		/*Hand the device to grail for gesture events*/
 } EventcommPrivate;
 
 extern Bool EventProcessEvent(InputInfoPtr pInfo, struct CommData *comm,
-                              struct SynapticsHwState *hwRet,
                               const struct input_event *ev);
+extern int GrailInit(InputInfoPtr pInfo);
 extern int GrailOpen(InputInfoPtr pInfo);
 extern void GrailClose(InputInfoPtr pInfo);
 
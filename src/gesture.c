@@ -0,0 +1,76 @@
+#include "gesture.h"
+#include "yolog.h"
+#include <math.h>
+
+YOLOG_STATIC_INIT("gesture.c", YOLOG_DEBUG);
+
+#define GESTURE_DOMINANCE 2.0	/* a swipe's axis must beat the other one by this */
+#define GESTURE_PINCH_DIST 0.5	/* spread change for a pinch, fraction of the swipe distance */
+#define GESTURE_ROTATE_ANGLE 0.3	/* radians turned for a rotation, about 17 degrees */
+
+void gesture_reset(GestureRecognizer *g)
+{
+	g->count = 0;
+	g->done = 0;
+	g->rotation = 0;
+}
+
+static int
+swipe(const GestureRecognizer *g, double dx, double dy, double dist)
+{
+	int base = (g->count == 3) ? SWIPE3_LEFT : SWIPE4_LEFT;
+
+	if (fabs(dx) >= dist && fabs(dx) >= GESTURE_DOMINANCE * fabs(dy))
+		return base + (dx < 0 ? 0 : 1);
+	/* device y grows downwards */
+	if (fabs(dy) >= dist && fabs(dy) >= GESTURE_DOMINANCE * fabs(dx))
+		return base + (dy < 0 ? 2 : 3);
+	return GESTURE_NONE;
+}
+
+/*
+ * Feed one report's contact summary. rotation is the turn since the last
+ * report, positive clockwise in device coordinates. Returns the gesture
+ * recognised with this report or GESTURE_NONE.
+ */
+int gesture_update(GestureRecognizer *g, int count, const double *centroid,
+		double spread, double rotation, double swipe_dist)
+{
+	double dx, dy, ds, d;
+	int ev = GESTURE_NONE;
+
+	if (count != g->count) {
+		g->count = count;
+		g->done = 0;
+		g->start[0] = centroid[0];
+		g->start[1] = centroid[1];
+		g->start_spread = spread;
+		g->rotation = 0;
+		return GESTURE_NONE;
+	}
+	if (g->done || count < 2)
+		return GESTURE_NONE;
+
+	g->rotation += rotation;
+	dx = centroid[0] - g->start[0];
+	dy = centroid[1] - g->start[1];
+
+	if (count == 3 || count == 4) {
+		ev = swipe(g, dx, dy, swipe_dist);
+	} else if (count == 2) {
+		/* the centroid of a pinch or rotation stays put, unlike a scroll */
+		ds = spread - g->start_spread;
+		d = hypot(dx, dy);
+		if (fabs(ds) >= GESTURE_PINCH_DIST * swipe_dist && fabs(ds) > d)
+			ev = (ds > 0) ? PINCH_OUT : PINCH_IN;
+		else if (fabs(g->rotation) >= GESTURE_ROTATE_ANGLE &&
+			 d < GESTURE_PINCH_DIST * swipe_dist)
+			ev = (g->rotation > 0) ? ROTATE_CW : ROTATE_CCW;
+	}
+
+	if (ev != GESTURE_NONE) {
+		g->done = 1;
+		yolog_debug("gesture %d with %d fingers", ev, count);
+	}
+	return ev;
+}
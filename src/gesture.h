@@ -0,0 +1,28 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include "synaptics.h"
+
+/*
+ * Multi-finger gesture recognition on top of the per-report contact
+ * summary: three and four finger swipes, two finger pinch and rotate.
+ * Every contact set (same number of fingers down) yields at most one
+ * gesture; the recognizer keeps no history beyond where the set started,
+ * so each report costs the same and nothing is allocated.
+ */
+
+#define GESTURE_NONE -1
+
+typedef struct {
+	int count;		/* contacts in the current set */
+	int done;		/* a gesture was reported for this set */
+	double start[2];	/* centroid where the set started */
+	double start_spread;	/* spread where the set started */
+	double rotation;	/* radians turned since the set started */
+} GestureRecognizer;
+
+void gesture_reset(GestureRecognizer *g);
+int gesture_update(GestureRecognizer *g, int count, const double *centroid,
+		double spread, double rotation, double swipe_dist);
+
+#endif /*GESTURE_H*/
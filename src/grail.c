@@ -57,6 +57,36 @@ extern _X_EXPORT void xf86PostGestureEvent(DeviceIntPtr dev, unsigned short x,
                          unsigned short status, unsigned short num_props,
                          float *props);
 
+/*
+ * Resolving the clients for a set of gestures walks from the window under
+ * the cursor up to the root, twice, for every gesture grail recognizes.
+ * While the contacts stay down that answer rarely changes, so the last one
+ * is kept, keyed on the child window and the gesture types. The server has
+ * no cheap way of telling us about window tree or gesture mask changes, so
+ * the cache is dropped when all contacts lift, when the child window goes
+ * away and after GRAIL_CACHE_MILLIS at the latest.
+ */
+#define GRAIL_CACHE_CLIENTS 8
+#define GRAIL_CACHE_MILLIS 250
+
+typedef struct {
+    Bool valid;
+    WindowPtr child;			/* window under the cursor ... */
+    XID child_id;			/* ... and its id, to spot a reused pointer */
+    int millis;				/* time the entry was made */
+    grail_mask_t types[DIM_GRAIL_TYPE_BYTES]; /* gestures asked for */
+    int type_bytes;
+    int num_clients;
+    struct grail_client_info clients[GRAIL_CACHE_CLIENTS];
+} GrailClientCache;
+
+typedef struct {
+    struct grail grail;			/* first, ecpriv->grail points here */
+    GrailClientCache cache;
+} SynapticsGrail;
+
+#define GRAIL_CACHE(g) (&((SynapticsGrail *)(g))->cache)
+
 static WindowPtr CommonAncestor(WindowPtr a, WindowPtr b)
 {
     WindowPtr c;
@@ -98,37 +128,18 @@ static WindowPtr GetWindowForGestures(struct grail *grail,
     return window;
 }
 
-static int GetClients(struct grail *grail,
-		      struct grail_client_info *clients, int max_clients,
-		      const struct grail_coord *contacts, int num_contacts,
-		      const grail_mask_t *types, int type_bytes)
+static int FindClients(struct grail *grail, WindowPtr child_window,
+		       struct grail_client_info *clients, int max_clients,
+		       const grail_mask_t *types, int type_bytes)
 {
-    WindowPtr child_window;
     WindowPtr window;
     WindowPtr root_window;
     InputInfoPtr pInfo = grail->priv;
-    DeviceIntPtr master = pInfo->dev->u.master;
-    struct grail_coord cursor_coord;
     int j;
     int found_match = 0;
     int num_clients = 0;
     int type;
 
-    if (max_clients <= 0)
-        return 0;
-
-    /* If this mouse isn't hooked up to a cursor, don't do anything */
-    if (!master)
-        return 0;
-
-    cursor_coord.x = master->last.valuators[0];
-    cursor_coord.y = master->last.valuators[1];
-
-    child_window = GetWindowForGestures(grail, &cursor_coord, 1);
-
-    if (!child_window)
-        return 0;
-
     memset(clients, 0, sizeof(struct grail_client_info) * max_clients);
 
     /* Find the root window. */
@@ -279,23 +290,108 @@ next_window:
     return num_clients;
 }
 
+static Bool CacheHit(GrailClientCache *cache, WindowPtr child_window,
+                     int max_clients, const grail_mask_t *types,
+                     int type_bytes, int millis)
+{
+    /* the window may have been destroyed and its memory reused */
+    if (!cache->valid || cache->child != child_window ||
+        cache->child_id != child_window->drawable.id ||
+        cache->type_bytes != type_bytes || cache->num_clients > max_clients ||
+        memcmp(cache->types, types, type_bytes) != 0)
+        return FALSE;
+
+    if ((int)(millis - cache->millis) >= GRAIL_CACHE_MILLIS)
+    {
+        cache->valid = FALSE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static int GetClients(struct grail *grail,
+		      struct grail_client_info *clients, int max_clients,
+		      const struct grail_coord *contacts, int num_contacts,
+		      const grail_mask_t *types, int type_bytes)
+{
+    GrailClientCache *cache = GRAIL_CACHE(grail);
+    WindowPtr child_window;
+    InputInfoPtr pInfo = grail->priv;
+    DeviceIntPtr master = pInfo->dev->u.master;
+    struct grail_coord cursor_coord;
+    int millis = GetTimeInMillis();
+    int num_clients;
+
+    if (max_clients <= 0)
+        return 0;
+
+    /* If this mouse isn't hooked up to a cursor, don't do anything */
+    if (!master)
+        return 0;
+
+    cursor_coord.x = master->last.valuators[0];
+    cursor_coord.y = master->last.valuators[1];
+
+    child_window = GetWindowForGestures(grail, &cursor_coord, 1);
+
+    if (!child_window)
+        return 0;
+
+    if (type_bytes > DIM_GRAIL_TYPE_BYTES)
+        return FindClients(grail, child_window, clients, max_clients,
+                           types, type_bytes);
+
+    if (CacheHit(cache, child_window, max_clients, types, type_bytes, millis))
+    {
+        memset(clients, 0, sizeof(struct grail_client_info) * max_clients);
+        memcpy(clients, cache->clients,
+               sizeof(struct grail_client_info) * cache->num_clients);
+        return cache->num_clients;
+    }
+
+    num_clients = FindClients(grail, child_window, clients, max_clients,
+                              types, type_bytes);
+
+    cache->valid = (num_clients >= 0 && num_clients <= GRAIL_CACHE_CLIENTS);
+    if (cache->valid)
+    {
+        cache->child = child_window;
+        cache->child_id = child_window->drawable.id;
+        cache->millis = millis;
+        memcpy(cache->types, types, type_bytes);
+        cache->type_bytes = type_bytes;
+        cache->num_clients = num_clients;
+        memcpy(cache->clients, clients,
+               sizeof(struct grail_client_info) * num_clients);
+    }
+
+    return num_clients;
+}
+
 static void GrailEvent(struct grail *grail, const struct input_event *ev)
 {
     InputInfoPtr pInfo = (InputInfoPtr)grail->priv;
     SynapticsPrivate *priv = (SynapticsPrivate *)pInfo->private;
+    EventcommPrivate *ecpriv = (EventcommPrivate *)priv->proto_data;
     struct SynapticsHwState hw;
     int delay = 0;
     Bool newDelay = FALSE;
 
-    if (EventProcessEvent(pInfo, &priv->comm, &hw, ev)) {
-        hw.millis = GetTimeInMillis();
-        priv->hwState = hw;
+    if (EventProcessEvent(pInfo, &priv->comm, ev)) {
+        priv->comm.hwState.millis = GetTimeInMillis();
+        hw = priv->comm.hwState;
         delay = HandleState(pInfo, &hw);
+        update_report_rate(pInfo, hw.millis, 1);
         newDelay = TRUE;
+
+        /* the next touch sequence looks the clients up afresh */
+        if (ecpriv->active_touches == 0)
+            GRAIL_CACHE(grail)->valid = FALSE;
     }
 
     if (newDelay)
-        priv->timer = TimerSet(priv->timer, 0, delay, timerFunc, pInfo);
+        arm_timer(pInfo, hw.millis, delay);
 }
 
 static void GrailGesture(struct grail *grail, const struct grail_event *ev)
@@ -321,19 +417,33 @@ static void GrailGesture(struct grail *grail, const struct grail_event *ev)
 }
 
 int
-GrailOpen(InputInfoPtr pInfo)
+GrailInit(InputInfoPtr pInfo)
 {
     SynapticsPrivate *priv = pInfo->private;
     EventcommPrivate *ecpriv = priv->proto_data;
 
-    ecpriv->grail = malloc(sizeof(struct grail));
-    if (!ecpriv->grail) {
+    ecpriv->grail_store = arena_alloc(&priv->arena, sizeof(SynapticsGrail));
+    if (!ecpriv->grail_store) {
         xf86Msg(X_ERROR, "%s: failed to allocate grail structure\n",
                 pInfo->name);
         return -1;
     }
 
-    memset(ecpriv->grail, 0, sizeof(struct grail));
+    return 0;
+}
+
+int
+GrailOpen(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = pInfo->private;
+    EventcommPrivate *ecpriv = priv->proto_data;
+
+    if (!ecpriv->grail_store)
+        return -1;
+
+    memset(ecpriv->grail_store, 0, sizeof(SynapticsGrail));
+    ecpriv->grail = ecpriv->grail_store;
+
     ecpriv->grail->get_clients = GetClients;
     ecpriv->grail->event = GrailEvent;
     ecpriv->grail->gesture = GrailGesture;
@@ -342,7 +452,6 @@ GrailOpen(InputInfoPtr pInfo)
     if (grail_open(ecpriv->grail, pInfo->fd)) {
         xf86Msg(X_INFO, "%s: failed to open grail, no gesture support\n",
                 pInfo->name);
-        free(ecpriv->grail);
         ecpriv->grail = NULL;
         return -1;
     }
@@ -370,7 +479,6 @@ GrailClose(InputInfoPtr pInfo)
 
     if (ecpriv->grail) {
         grail_close(ecpriv->grail, pInfo->fd);
-        free(ecpriv->grail);
         ecpriv->grail = NULL;
     }
 }
@@ -0,0 +1,148 @@
+#include "kinetic.h"
+#include "yolog.h"
+#include <math.h>
+
+YOLOG_STATIC_INIT("kinetic.c", YOLOG_DEBUG);
+
+/*
+ * With deceleration a and time constant tau the speed follows
+ * ds/dt = -s/tau - a, i.e.
+ *   s(t) = (s0 + a tau) e^(-t/tau) - a tau
+ *   d(t) = (s0 + a tau) tau (1 - e^(-t/tau)) - a tau t
+ * and for tau = 0 the plain s(t) = s0 - a t.
+ */
+
+static double
+speed_at(const KineticScroll *k, double s0, double t)
+{
+	if (k->tau > 0)
+		return (s0 + k->friction * k->tau) * exp(-t / k->tau) -
+			k->friction * k->tau;
+	return s0 - k->friction * t;
+}
+
+static double
+distance_at(const KineticScroll *k, double s0, double t)
+{
+	if (k->tau > 0)
+		return (s0 + k->friction * k->tau) * k->tau *
+			(1 - exp(-t / k->tau)) - k->friction * k->tau * t;
+	return s0 * t - k->friction * t * t / 2;
+}
+
+/* seconds until the speed drops to stop_speed, HUGE_VAL if never */
+static double
+stop_time(const KineticScroll *k, double s0)
+{
+	double at = k->friction * k->tau;
+
+	if (s0 <= k->stop_speed)
+		return 0;
+	if (k->tau > 0) {
+		if (k->stop_speed + at <= 0)
+			return HUGE_VAL;
+		return k->tau * log((s0 + at) / (k->stop_speed + at));
+	}
+	if (k->friction <= 0)
+		return HUGE_VAL;
+	return (s0 - k->stop_speed) / k->friction;
+}
+
+void kinetic_start(KineticScroll *k, double vx, double vy, double friction,
+		double tau, double stop_speed, int millis)
+{
+	k->vx = vx;
+	k->vy = vy;
+	k->friction = friction > 0 ? friction : 0;
+	k->tau = tau > 0 ? tau : 0;
+	k->stop_speed = stop_speed;
+	k->millis = millis;
+	k->active = hypot(vx, vy) > stop_speed;
+}
+
+void kinetic_stop(KineticScroll *k)
+{
+	k->active = 0;
+	k->vx = k->vy = 0;
+}
+
+/*
+ * Advance to millis. The distance travelled since the last step is
+ * returned in dx/dy; returns whether the motion goes on.
+ */
+int kinetic_step(KineticScroll *k, int millis, double *dx, double *dy)
+{
+	double s0, s1, d, t, tmax;
+
+	*dx = *dy = 0;
+	if (!k->active)
+		return 0;
+
+	t = (int)(millis - k->millis) / 1000.0;
+	if (t <= 0)
+		return 1;
+	k->millis = millis;
+
+	s0 = hypot(k->vx, k->vy);
+	tmax = stop_time(k, s0);
+	if (t >= tmax) {
+		t = tmax;
+		k->active = 0;
+	}
+
+	d = distance_at(k, s0, t);
+	s1 = k->active ? speed_at(k, s0, t) : 0;
+	*dx = k->vx / s0 * d;
+	*dy = k->vy / s0 * d;
+	k->vx *= s1 / s0;
+	k->vy *= s1 / s0;
+
+	return k->active;
+}
+
+/* seconds of motion left */
+double kinetic_remaining(const KineticScroll *k)
+{
+	return k->active ? stop_time(k, hypot(k->vx, k->vy)) : 0;
+}
+
+/*
+ * Velocity in units per second from the last backlog entries of log, as the
+ * least squares slope over their timestamps. Returns 0 if the log holds too
+ * little data.
+ */
+int kinetic_estimate(SynhistLog *log, int backlog, double *v)
+{
+	int values[SYNHIST_LOG_MAX], times[SYNHIST_LOG_MAX];
+	int *tmp;
+	double tmean = 0, vmean = 0, stt = 0, stv = 0;
+	int i, t0;
+
+	if (backlog < 2 || backlog > SYNHIST_LOG_MAX || log->count < backlog)
+		return 0;
+
+	tmp = values;
+	synhist_last_values(log, backlog, &tmp);
+	tmp = times;
+	synhist_last_times(log, backlog, &tmp);
+
+	/* times relative to the newest entry to stay clear of wraparound */
+	t0 = times[0];
+	for (i = 0; i < backlog; i++) {
+		times[i] -= t0;
+		tmean += times[i];
+		vmean += values[i];
+	}
+	tmean /= backlog;
+	vmean /= backlog;
+	for (i = 0; i < backlog; i++) {
+		stt += (times[i] - tmean) * (times[i] - tmean);
+		stv += (times[i] - tmean) * (values[i] - vmean);
+	}
+	if (stt <= 0)
+		return 0;
+
+	*v = stv / stt * 1000;
+	yolog_debug("estimated %0.1f/s over %d entries", *v, backlog);
+	return 1;
+}
@@ -0,0 +1,30 @@
+#ifndef KINETIC_H
+#define KINETIC_H
+
+#include "synhist.h"
+
+/*
+ * Kinetic (coasting) scrolling. The velocity is a 2D vector in scroll
+ * units per second which slows down along its direction through a constant
+ * deceleration and/or an exponential decay. Steps integrate the motion
+ * exactly over the elapsed time, so the distance travelled does not depend
+ * on how often they run.
+ */
+
+typedef struct {
+	int active;
+	double vx, vy;		/* velocity, units per second */
+	double friction;	/* constant deceleration, units per second^2 */
+	double tau;		/* time constant of the decay in seconds, 0 for none */
+	double stop_speed;	/* the motion ends below this speed */
+	int millis;		/* time of the last step */
+} KineticScroll;
+
+void kinetic_start(KineticScroll *k, double vx, double vy, double friction,
+		double tau, double stop_speed, int millis);
+void kinetic_stop(KineticScroll *k);
+int kinetic_step(KineticScroll *k, int millis, double *dx, double *dy);
+double kinetic_remaining(const KineticScroll *k);
+int kinetic_estimate(SynhistLog *log, int backlog, double *v);
+
+#endif /*KINETIC_H*/
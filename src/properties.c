@@ -44,6 +44,8 @@
 #endif
 static Atom float_type;
 
+static void InitPropHandlers(void);
+
 Atom prop_edges                 = 0;
 Atom prop_finger                = 0;
 Atom prop_tap_time              = 0;
@@ -68,12 +70,15 @@ Atom prop_lockdrags             = 0;
 Atom prop_lockdrags_time        = 0;
 Atom prop_tapaction             = 0;
 Atom prop_clickaction           = 0;
+Atom prop_gestureaction         = 0;
+Atom prop_gesturekeys           = 0;
 Atom prop_circscroll            = 0;
 Atom prop_circscroll_dist       = 0;
 Atom prop_circscroll_trigger    = 0;
 Atom prop_circpad               = 0;
 Atom prop_palm                  = 0;
 Atom prop_palm_dim              = 0;
+Atom prop_palm_major            = 0;
 Atom prop_coastspeed            = 0;
 Atom prop_pressuremotion        = 0;
 Atom prop_pressuremotion_factor = 0;
@@ -84,15 +89,20 @@ Atom prop_capabilities          = 0;
 Atom prop_resolution            = 0;
 Atom prop_area                  = 0;
 Atom prop_noise_cancellation    = 0;
+Atom prop_accel_curve           = 0;
+Atom prop_prediction            = 0;
+Atom prop_resample_rate         = 0;
+Atom prop_softbutton_areas      = 0;
+Atom prop_coastdecay            = 0;
 
 static Atom
 InitAtom(DeviceIntPtr dev, char *name, int format, int nvalues, int *values)
 {
     int i;
     Atom atom;
-    uint8_t val_8[9]; /* we never have more than 9 values in an atom */
-    uint16_t val_16[9];
-    uint32_t val_32[9];
+    uint8_t val_8[MAX_GESTURE]; /* we never have more than MAX_GESTURE values in an atom */
+    uint16_t val_16[MAX_GESTURE];
+    uint32_t val_32[MAX_GESTURE];
     pointer converted;
 
 
@@ -138,7 +148,7 @@ InitDeviceProperties(InputInfoPtr pInfo)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
     SynapticsParameters *para = &priv->synpara;
-    int values[9]; /* we never have more than 9 values in an atom */
+    int values[MAX_GESTURE]; /* we never have more than MAX_GESTURE values in an atom */
     float fvalues[4]; /* never have more than 4 float values */
 
     float_type = XIGetKnownProperty(XATOM_FLOAT);
@@ -230,6 +240,12 @@ InitDeviceProperties(InputInfoPtr pInfo)
     memcpy(values, para->click_action, MAX_CLICK * sizeof(int));
     prop_clickaction = InitAtom(pInfo->dev, SYNAPTICS_PROP_CLICK_ACTION, 8, MAX_CLICK, values);
 
+    memcpy(values, para->gesture_action, MAX_GESTURE * sizeof(int));
+    prop_gestureaction = InitAtom(pInfo->dev, SYNAPTICS_PROP_GESTURE_ACTION, 8, MAX_GESTURE, values);
+
+    memcpy(values, para->gesture_key, MAX_GESTURE * sizeof(int));
+    prop_gesturekeys = InitAtom(pInfo->dev, SYNAPTICS_PROP_GESTURE_KEYS, 8, MAX_GESTURE, values);
+
     prop_circscroll = InitAtom(pInfo->dev, SYNAPTICS_PROP_CIRCULAR_SCROLLING, 8, 1, &para->circular_scrolling);
 
     fvalues[0] = para->scroll_dist_circ;
@@ -244,10 +260,17 @@ InitDeviceProperties(InputInfoPtr pInfo)
 
     prop_palm_dim = InitAtom(pInfo->dev, SYNAPTICS_PROP_PALM_DIMENSIONS, 32, 2, values);
 
+    values[0] = para->thumb_min_major;
+    values[1] = para->palm_min_major;
+    prop_palm_major = InitAtom(pInfo->dev, SYNAPTICS_PROP_PALM_TOUCH_MAJOR, 32, 2, values);
+
     fvalues[0] = para->coasting_speed;
     fvalues[1] = para->coasting_friction;
     prop_coastspeed = InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_COASTING_SPEED, 2, fvalues);
 
+    fvalues[0] = para->coasting_decay;
+    prop_coastdecay = InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_COASTING_DECAY, 1, fvalues);
+
     values[0] = para->press_motion_min_z;
     values[1] = para->press_motion_max_z;
     prop_pressuremotion = InitAtom(pInfo->dev, SYNAPTICS_PROP_PRESSURE_MOTION, 32, 2, values);
@@ -286,395 +309,665 @@ InitDeviceProperties(InputInfoPtr pInfo)
     prop_noise_cancellation = InitAtom(pInfo->dev,
             SYNAPTICS_PROP_NOISE_CANCELLATION, 32, 2, values);
 
+    prop_accel_curve = InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_ACCEL_CURVE,
+                                     para->accel_curve_len, para->accel_curve);
+
+    fvalues[0] = para->predict_horizon;
+    fvalues[1] = para->predict_damping;
+    prop_prediction = InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_PREDICTION, 2, fvalues);
+
+    prop_resample_rate = InitAtom(pInfo->dev, SYNAPTICS_PROP_RESAMPLE_RATE, 32, 1, &para->resample_rate);
+
+    prop_softbutton_areas = InitAtom(pInfo->dev, SYNAPTICS_PROP_SOFTBUTTON_AREAS, 32,
+                                     SOFTBUTTON_AREAS * 4, &para->softbutton_areas[0][0]);
+
+    InitPropHandlers();
 }
 
-int
-SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
-            BOOL checkonly)
+/*
+ * SetProperty dispatch. Each writable property has a handler with the
+ * format, type and number of values it accepts and a setter that checks and
+ * applies them. The handlers are found through a hash on the atom, built
+ * once the atoms exist, so a property costs the same however many there
+ * are.
+ */
+typedef int (*PropSetter)(SynapticsPrivate *priv, SynapticsParameters *para,
+                          XIPropertyValuePtr prop);
+
+#define REBUILD_SCROLL (1 << 0)         /* SynapticsSetScrollValuators() */
+
+typedef struct {
+    Atom *atom;                         /* the prop_* variable */
+    int format;                         /* 8 or 32 */
+    Bool is_float;                      /* FLOAT instead of INTEGER */
+    int min_size, max_size;             /* accepted number of values */
+    PropSetter set;                     /* NULL for read-only properties */
+    int rebuild;                        /* device state to redo, REBUILD_* */
+} PropHandler;
+
+static int
+SetEdges(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
 {
-    InputInfoPtr pInfo = dev->public.devicePrivate;
-    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
-    SynapticsParameters *para = &priv->synpara;
-    SynapticsParameters tmp;
+    INT32 *edges = (INT32*)prop->data;
 
-    /* If checkonly is set, no parameters may be changed. So just let the code
-     * change temporary variables and forget about it. */
-    if (checkonly)
-    {
-        tmp = *para;
-        para = &tmp;
-    }
+    if (edges[0] > edges[1] || edges[2] > edges[3])
+        return BadValue;
 
-    if (property == prop_edges)
-    {
-        INT32 *edges;
-        if (prop->size != 4 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->left_edge   = edges[0];
+    para->right_edge  = edges[1];
+    para->top_edge    = edges[2];
+    para->bottom_edge = edges[3];
+    return Success;
+}
 
-        edges = (INT32*)prop->data;
-        if (edges[0] > edges[1] || edges[2] > edges[3])
-            return BadValue;
+static int
+SetFinger(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *finger = (INT32*)prop->data;
 
-        para->left_edge   = edges[0];
-        para->right_edge  = edges[1];
-        para->top_edge    = edges[2];
-        para->bottom_edge = edges[3];
+    if (finger[0] > finger[1])
+        return BadValue;
 
-    } else if (property == prop_finger)
-    {
-        INT32 *finger;
-        if (prop->size != 3 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->finger_low   = finger[0];
+    para->finger_high  = finger[1];
+    para->finger_press = finger[2];
+    return Success;
+}
 
-        finger = (INT32*)prop->data;
-        if (finger[0] > finger[1])
-            return BadValue;
+static int
+SetTapTime(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->tap_time = *(INT32*)prop->data;
+    return Success;
+}
 
-        para->finger_low   = finger[0];
-        para->finger_high  = finger[1];
-        para->finger_press = finger[2];
+static int
+SetTapMove(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->tap_move = *(INT32*)prop->data;
+    return Success;
+}
 
-    } else if (property == prop_tap_time)
-    {
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetTapDurations(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *timeouts = (INT32*)prop->data;
 
-        para->tap_time = *(INT32*)prop->data;
+    para->single_tap_timeout = timeouts[0];
+    para->tap_time_2         = timeouts[1];
+    para->click_time         = timeouts[2];
+    return Success;
+}
 
-    } else if (property == prop_tap_move)
-    {
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetTapFast(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->fast_taps = *(BOOL*)prop->data;
+    return Success;
+}
 
-        para->tap_move = *(INT32*)prop->data;
-    } else if (property == prop_tap_durations)
-    {
-        INT32 *timeouts;
+static int
+SetMiddleTimeout(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->emulate_mid_button_time = *(INT32*)prop->data;
+    return Success;
+}
 
-        if (prop->size != 3 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetTwofingerPressure(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->emulate_twofinger_z = *(INT32*)prop->data;
+    return Success;
+}
 
-        timeouts = (INT32*)prop->data;
+static int
+SetTwofingerWidth(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->emulate_twofinger_w = *(INT32*)prop->data;
+    return Success;
+}
 
-        para->single_tap_timeout = timeouts[0];
-        para->tap_time_2         = timeouts[1];
-        para->click_time         = timeouts[2];
+static int
+SetScrollDist(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *dist = (INT32*)prop->data;
 
-    } else if (property == prop_tap_fast)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->scroll_dist_vert = dist[0];
+    para->scroll_dist_horiz = dist[1];
+    return Success;
+}
 
-        para->fast_taps = *(BOOL*)prop->data;
+static int
+SetScrollEdge(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 *edge = (CARD8*)prop->data;
 
-    } else if (property == prop_middle_timeout)
-    {
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->scroll_edge_vert   = edge[0];
+    para->scroll_edge_horiz  = edge[1];
+    para->scroll_edge_corner = edge[2];
+    return Success;
+}
 
-        para->emulate_mid_button_time = *(INT32*)prop->data;
-    } else if (property == prop_twofinger_pressure)
-    {
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetScrollTwofinger(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 *twofinger = (CARD8*)prop->data;
 
-        para->emulate_twofinger_z = *(INT32*)prop->data;
-    } else if (property == prop_twofinger_width)
-    {
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->scroll_twofinger_vert  = twofinger[0];
+    para->scroll_twofinger_horiz = twofinger[1];
+    return Success;
+}
 
-        para->emulate_twofinger_w = *(INT32*)prop->data;
-    } else if (property == prop_scrolldist)
-    {
-        INT32 *dist;
-        if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
-
-        dist = (INT32*)prop->data;
-        para->scroll_dist_vert = dist[0];
-        para->scroll_dist_horiz = dist[1];
-    } else if (property == prop_scrolledge)
-    {
-        CARD8 *edge;
-        if (prop->size != 3 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
-
-        edge = (BOOL*)prop->data;
-        para->scroll_edge_vert   = edge[0];
-        para->scroll_edge_horiz  = edge[1];
-        para->scroll_edge_corner = edge[2];
-    } else if (property == prop_scrolltwofinger)
-    {
-        CARD8 *twofinger;
+static int
+SetSpeed(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    float *speed = (float*)prop->data;
 
-        if (prop->size != 2 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->min_speed = speed[0];
+    para->max_speed = speed[1];
+    para->accl = speed[2];
+    para->trackstick_speed = speed[3];
+    return Success;
+}
 
-        twofinger = (BOOL*)prop->data;
-        para->scroll_twofinger_vert  = twofinger[0];
-        para->scroll_twofinger_horiz = twofinger[1];
-    } else if (property == prop_speed)
-    {
-        float *speed;
+static int
+SetEdgeMotionPressure(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD32 *pressure = (CARD32*)prop->data;
 
-        if (prop->size != 4 || prop->format != 32 || prop->type != float_type)
-            return BadMatch;
+    if (pressure[0] > pressure[1])
+        return BadValue;
 
-        speed = (float*)prop->data;
-        para->min_speed = speed[0];
-        para->max_speed = speed[1];
-        para->accl = speed[2];
-        para->trackstick_speed = speed[3];
+    para->edge_motion_min_z = pressure[0];
+    para->edge_motion_max_z = pressure[1];
+    return Success;
+}
 
-    } else if (property == prop_edgemotion_pressure)
-    {
-        CARD32 *pressure;
+static int
+SetEdgeMotionSpeed(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD32 *speed = (CARD32*)prop->data;
 
-        if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    if (speed[0] > speed[1])
+        return BadValue;
 
-        pressure = (CARD32*)prop->data;
-        if (pressure[0] > pressure[1])
-            return BadValue;
+    para->edge_motion_min_speed = speed[0];
+    para->edge_motion_max_speed = speed[1];
+    return Success;
+}
 
-        para->edge_motion_min_z = pressure[0];
-        para->edge_motion_max_z = pressure[1];
+static int
+SetEdgeMotionAlways(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->edge_motion_use_always = *(BOOL*)prop->data;
+    return Success;
+}
 
-    } else if (property == prop_edgemotion_speed)
-    {
-        CARD32 *speed;
+static int
+SetButtonScroll(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    BOOL *scroll = (BOOL*)prop->data;
 
-        if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    if (!priv->has_scrollbuttons)
+        return BadMatch;
 
-        speed = (CARD32*)prop->data;
-        if (speed[0] > speed[1])
-            return BadValue;
+    para->updown_button_scrolling    = scroll[0];
+    para->leftright_button_scrolling = scroll[1];
+    return Success;
+}
+
+static int
+SetButtonScrollRepeat(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    BOOL *repeat = (BOOL*)prop->data;
 
-        para->edge_motion_min_speed = speed[0];
-        para->edge_motion_max_speed = speed[1];
+    if (!priv->has_scrollbuttons)
+        return BadMatch;
 
-    } else if (property == prop_edgemotion_always)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->updown_button_repeat    = repeat[0];
+    para->leftright_button_repeat = repeat[1];
+    return Success;
+}
 
-        para->edge_motion_use_always = *(BOOL*)prop->data;
+static int
+SetButtonScrollTime(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    if (!priv->has_scrollbuttons)
+        return BadMatch;
 
-    } else if (property == prop_buttonscroll)
-    {
-        BOOL *scroll;
+    para->scroll_button_repeat = *(INT32*)prop->data;
+    return Success;
+}
 
-        if (!priv->has_scrollbuttons)
-            return BadMatch;
+static int
+SetOff(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 off = *(CARD8*)prop->data;
 
-        if (prop->size != 2 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    if (off > 2)
+        return BadValue;
 
-        scroll = (BOOL*)prop->data;
-        para->updown_button_scrolling    = scroll[0];
-        para->leftright_button_scrolling = scroll[1];
+    para->touchpad_off = off;
+    return Success;
+}
 
-    } else if (property == prop_buttonscroll_repeat)
-    {
-        BOOL *repeat;
+static int
+SetGestures(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->tap_and_drag_gesture = *(BOOL*)prop->data;
+    return Success;
+}
 
-        if (!priv->has_scrollbuttons)
-            return BadMatch;
+static int
+SetLockDrags(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->locked_drags = *(BOOL*)prop->data;
+    return Success;
+}
 
-        if (prop->size != 2 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetLockDragsTime(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->locked_drag_time = *(INT32*)prop->data;
+    return Success;
+}
 
-        repeat = (BOOL*)prop->data;
-        para->updown_button_repeat    = repeat[0];
-        para->leftright_button_repeat = repeat[1];
-    } else if (property == prop_buttonscroll_time)
-    {
-        if (!priv->has_scrollbuttons)
-            return BadMatch;
+static int
+SetTapAction(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 *action = (CARD8*)prop->data;
+    int i;
 
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    for (i = 0; i < prop->size; i++)
+        para->tap_action[i] = action[i];
+    return Success;
+}
 
-        para->scroll_button_repeat = *(INT32*)prop->data;
+static int
+SetClickAction(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 *action = (CARD8*)prop->data;
+    int i;
 
-    } else if (property == prop_off)
-    {
-        CARD8 off;
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    for (i = 0; i < prop->size; i++)
+        para->click_action[i] = action[i];
+    return Success;
+}
 
-        off = *(CARD8*)prop->data;
+static int
+SetGestureAction(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 *action = (CARD8*)prop->data;
+    int i;
+
+    for (i = 0; i < prop->size; i++)
+        para->gesture_action[i] = action[i];
+    return Success;
+}
 
-        if (off > 2)
+static int
+SetGestureKeys(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    CARD8 *key = (CARD8*)prop->data;
+    int i;
+
+    for (i = 0; i < prop->size; i++)
+        if (key[i] && key[i] < SYN_MIN_KEYCODE)
             return BadValue;
 
-        para->touchpad_off = off;
-    } else if (property == prop_gestures)
-    {
-        BOOL *gestures;
+    for (i = 0; i < prop->size; i++)
+        para->gesture_key[i] = key[i];
+    return Success;
+}
 
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetCircScroll(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->circular_scrolling = *(BOOL*)prop->data;
+    return Success;
+}
 
-        gestures = (BOOL*)prop->data;
-        para->tap_and_drag_gesture = gestures[0];
-    } else if (property == prop_lockdrags)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetCircScrollDist(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->scroll_dist_circ = *(float*)prop->data;
+    return Success;
+}
 
-        para->locked_drags = *(BOOL*)prop->data;
-    } else if (property == prop_lockdrags_time)
-    {
-        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetCircScrollTrigger(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    int trigger = *(CARD8*)prop->data;
 
-        para->locked_drag_time = *(INT32*)prop->data;
-    } else if (property == prop_tapaction)
-    {
-        int i;
-        CARD8 *action;
+    if (trigger > 8)
+        return BadValue;
 
-        if (prop->size > MAX_TAP || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->circular_trigger = trigger;
+    return Success;
+}
 
-        action = (CARD8*)prop->data;
+static int
+SetCircPad(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->circular_pad = *(BOOL*)prop->data;
+    return Success;
+}
 
-        for (i = 0; i < MAX_TAP; i++)
-            para->tap_action[i] = action[i];
-    } else if (property == prop_clickaction)
-    {
-        int i;
-        CARD8 *action;
+static int
+SetPalm(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->palm_detect = *(BOOL*)prop->data;
+    return Success;
+}
 
-        if (prop->size > MAX_CLICK || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetPalmDim(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *dim = (INT32*)prop->data;
 
-        action = (CARD8*)prop->data;
+    para->palm_min_width = dim[0];
+    para->palm_min_z     = dim[1];
+    return Success;
+}
 
-        for (i = 0; i < MAX_CLICK; i++)
-            para->click_action[i] = action[i];
-    } else if (property == prop_circscroll)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetPalmMajor(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *major = (INT32*)prop->data;
 
-        para->circular_scrolling = *(BOOL*)prop->data;
+    if (major[0] < 0 || major[1] < 0)
+        return BadValue;
 
-    } else if (property == prop_circscroll_dist)
-    {
-        float circdist;
+    para->thumb_min_major = major[0];
+    para->palm_min_major  = major[1];
+    return Success;
+}
 
-        if (prop->size != 1 || prop->format != 32 || prop->type != float_type)
-            return BadMatch;
+static int
+SetCoastSpeed(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    float *coast_speeds = (float*)prop->data;
 
-        circdist = *(float*)prop->data;
-        para->scroll_dist_circ = circdist;
-    } else if (property == prop_circscroll_trigger)
-    {
-        int trigger;
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->coasting_speed = coast_speeds[0];
+    para->coasting_friction = coast_speeds[1];
+    return Success;
+}
 
-        trigger = *(CARD8*)prop->data;
-        if (trigger > 8)
-            return BadValue;
+static int
+SetCoastDecay(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    float decay = *(float*)prop->data;
 
-        para->circular_trigger = trigger;
+    if (decay < 0)
+        return BadValue;
 
-    } else if (property == prop_circpad)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->coasting_decay = decay;
+    return Success;
+}
 
-        para->circular_pad = *(BOOL*)prop->data;
-    } else if (property == prop_palm)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetPressureMotion(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *press = (INT32*)prop->data;
 
-        para->palm_detect = *(BOOL*)prop->data;
-    } else if (property == prop_palm_dim)
-    {
-        INT32 *dim;
+    if (press[0] > press[1])
+        return BadValue;
 
-        if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
+    para->press_motion_min_z = press[0];
+    para->press_motion_max_z = press[1];
+    return Success;
+}
 
-        dim = (INT32*)prop->data;
+static int
+SetPressureMotionFactor(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    float *factor = (float*)prop->data;
 
-        para->palm_min_width = dim[0];
-        para->palm_min_z     = dim[1];
-    } else if (property == prop_coastspeed)
-    {
-        float *coast_speeds;
+    if (factor[0] > factor[1])
+        return BadValue;
 
-        if (prop->size != 2 || prop->format != 32 || prop->type != float_type)
-            return BadMatch;
+    para->press_motion_min_factor = factor[0];
+    para->press_motion_max_factor = factor[1];
+    return Success;
+}
 
-        coast_speeds = (float*)prop->data;
-        para->coasting_speed = coast_speeds[0];
-        para->coasting_friction = coast_speeds[1];
-    } else if (property == prop_pressuremotion)
-    {
-        float *press;
-        if (prop->size != 2 || prop->format != 32 || prop->type != float_type)
-            return BadMatch;
+static int
+SetResolutionDetect(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->resolution_detect = *(BOOL*)prop->data;
+    return Success;
+}
+
+static int
+SetGrab(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    para->grab_event_device = *(BOOL*)prop->data;
+    return Success;
+}
+
+static int
+SetArea(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *area = (INT32*)prop->data;
+
+    if ((((area[0] != 0) && (area[1] != 0)) && (area[0] > area[1]) ) || (((area[2] != 0) && (area[3] != 0)) && (area[2] > area[3])))
+        return BadValue;
+
+    para->area_left_edge   = area[0];
+    para->area_right_edge  = area[1];
+    para->area_top_edge    = area[2];
+    para->area_bottom_edge = area[3];
+    return Success;
+}
+
+static int
+SetNoiseCancellation(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *hyst = (INT32*)prop->data;
+
+    if (hyst[0] < 0 || hyst[1] < 0)
+        return BadValue;
 
-        press = (float*)prop->data;
-        if (press[0] > press[1])
+    para->hyst_x = hyst[0];
+    para->hyst_y = hyst[1];
+    return Success;
+}
+
+static int
+SetAccelCurve(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    float *curve = (float*)prop->data;
+    int i;
+
+    if (prop->size > 0 && prop->size < 3)
+        return BadMatch;
+
+    if (prop->size > 0 && curve[0] <= 0)
+        return BadValue;
+    for (i = 0; i < prop->size; i++)
+        if (curve[i] < 0)
             return BadValue;
 
-        para->press_motion_min_z = press[0];
-        para->press_motion_max_z = press[1];
-    } else if (property == prop_resolution_detect)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+    memcpy(para->accel_curve, curve, prop->size * sizeof(float));
+    para->accel_curve_len = prop->size;
+    return Success;
+}
 
-        para->resolution_detect = *(BOOL*)prop->data;
-    } else if (property == prop_grab)
-    {
-        if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
-            return BadMatch;
+static int
+SetPrediction(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    float *pred = (float*)prop->data;
 
-        para->grab_event_device = *(BOOL*)prop->data;
-    } else if (property == prop_capabilities)
-    {
-        /* read-only */
+    if (pred[0] < 0 || pred[1] < 0 || pred[1] >= 1)
         return BadValue;
-    } else if (property == prop_resolution)
-    {
-        /* read-only */
+
+    para->predict_horizon = pred[0];
+    para->predict_damping = pred[1];
+    return Success;
+}
+
+static int
+SetResampleRate(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 rate = *(INT32*)prop->data;
+
+    if (rate < 0 || rate > 1000)
         return BadValue;
-    } else if (property == prop_area)
-    {
-        INT32 *area;
-        if (prop->size != 4 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
 
-        area = (INT32*)prop->data;
-        if ((((area[0] != 0) && (area[1] != 0)) && (area[0] > area[1]) ) || (((area[2] != 0) && (area[3] != 0)) && (area[2] > area[3])))
-            return BadValue;
+    para->resample_rate = rate;
+    return Success;
+}
 
-        para->area_left_edge   = area[0];
-        para->area_right_edge  = area[1];
-        para->area_top_edge    = area[2];
-        para->area_bottom_edge = area[3];
-    } else if (property == prop_noise_cancellation) {
-        INT32 *hyst;
-        if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
-            return BadMatch;
-
-        hyst = (INT32*)prop->data;
-        if (hyst[0] < 0 || hyst[1] < 0)
+static int
+SetSoftButtonAreas(SynapticsPrivate *priv, SynapticsParameters *para, XIPropertyValuePtr prop)
+{
+    INT32 *areas = (INT32*)prop->data;
+    int i;
+
+    for (i = 0; i < SOFTBUTTON_AREAS * 4; i += 2)
+        if (areas[i] > areas[i + 1])
             return BadValue;
-        para->hyst_x = hyst[0];
-        para->hyst_y = hyst[1];
-    }
 
+    for (i = 0; i < SOFTBUTTON_AREAS * 4; i++)
+        para->softbutton_areas[i / 4][i % 4] = areas[i];
     return Success;
 }
 
+static const PropHandler prop_handlers[] = {
+    { &prop_edges,                 32, FALSE, 4, 4, SetEdges, 0 },
+    { &prop_finger,                32, FALSE, 3, 3, SetFinger, 0 },
+    { &prop_tap_time,              32, FALSE, 1, 1, SetTapTime, 0 },
+    { &prop_tap_move,              32, FALSE, 1, 1, SetTapMove, 0 },
+    { &prop_tap_durations,         32, FALSE, 3, 3, SetTapDurations, 0 },
+    { &prop_tap_fast,               8, FALSE, 1, 1, SetTapFast, 0 },
+    { &prop_middle_timeout,        32, FALSE, 1, 1, SetMiddleTimeout, 0 },
+    { &prop_twofinger_pressure,    32, FALSE, 1, 1, SetTwofingerPressure, 0 },
+    { &prop_twofinger_width,       32, FALSE, 1, 1, SetTwofingerWidth, 0 },
+    { &prop_scrolldist,            32, FALSE, 2, 2, SetScrollDist, REBUILD_SCROLL },
+    { &prop_scrolledge,             8, FALSE, 3, 3, SetScrollEdge, 0 },
+    { &prop_scrolltwofinger,        8, FALSE, 2, 2, SetScrollTwofinger, 0 },
+    { &prop_speed,                 32, TRUE,  4, 4, SetSpeed, 0 },
+    { &prop_edgemotion_pressure,   32, FALSE, 2, 2, SetEdgeMotionPressure, 0 },
+    { &prop_edgemotion_speed,      32, FALSE, 2, 2, SetEdgeMotionSpeed, 0 },
+    { &prop_edgemotion_always,      8, FALSE, 1, 1, SetEdgeMotionAlways, 0 },
+    { &prop_buttonscroll,           8, FALSE, 2, 2, SetButtonScroll, 0 },
+    { &prop_buttonscroll_repeat,    8, FALSE, 2, 2, SetButtonScrollRepeat, 0 },
+    { &prop_buttonscroll_time,     32, FALSE, 1, 1, SetButtonScrollTime, 0 },
+    { &prop_off,                    8, FALSE, 1, 1, SetOff, 0 },
+    { &prop_gestures,               8, FALSE, 1, 1, SetGestures, 0 },
+    { &prop_lockdrags,              8, FALSE, 1, 1, SetLockDrags, 0 },
+    { &prop_lockdrags_time,        32, FALSE, 1, 1, SetLockDragsTime, 0 },
+    { &prop_tapaction,              8, FALSE, 0, MAX_TAP, SetTapAction, 0 },
+    { &prop_clickaction,            8, FALSE, 0, MAX_CLICK, SetClickAction, 0 },
+    { &prop_gestureaction,          8, FALSE, 0, MAX_GESTURE, SetGestureAction, 0 },
+    { &prop_gesturekeys,            8, FALSE, 0, MAX_GESTURE, SetGestureKeys, 0 },
+    { &prop_circscroll,             8, FALSE, 1, 1, SetCircScroll, 0 },
+    { &prop_circscroll_dist,       32, TRUE,  1, 1, SetCircScrollDist, 0 },
+    { &prop_circscroll_trigger,     8, FALSE, 1, 1, SetCircScrollTrigger, 0 },
+    { &prop_circpad,                8, FALSE, 1, 1, SetCircPad, 0 },
+    { &prop_palm,                   8, FALSE, 1, 1, SetPalm, 0 },
+    { &prop_palm_dim,              32, FALSE, 2, 2, SetPalmDim, 0 },
+    { &prop_palm_major,            32, FALSE, 2, 2, SetPalmMajor, 0 },
+    { &prop_coastspeed,            32, TRUE,  2, 2, SetCoastSpeed, 0 },
+    { &prop_coastdecay,            32, TRUE,  1, 1, SetCoastDecay, 0 },
+    { &prop_pressuremotion,        32, FALSE, 2, 2, SetPressureMotion, 0 },
+    { &prop_pressuremotion_factor, 32, TRUE,  2, 2, SetPressureMotionFactor, 0 },
+    { &prop_resolution_detect,      8, FALSE, 1, 1, SetResolutionDetect, 0 },
+    { &prop_grab,                   8, FALSE, 1, 1, SetGrab, 0 },
+    { &prop_capabilities,           0, FALSE, 0, 0, NULL, 0 },
+    { &prop_resolution,             0, FALSE, 0, 0, NULL, 0 },
+    { &prop_area,                  32, FALSE, 4, 4, SetArea, 0 },
+    { &prop_noise_cancellation,    32, FALSE, 2, 2, SetNoiseCancellation, 0 },
+    { &prop_accel_curve,           32, TRUE,  0, SYN_ACCEL_CURVE_MAX, SetAccelCurve, 0 },
+    { &prop_prediction,            32, TRUE,  2, 2, SetPrediction, 0 },
+    { &prop_resample_rate,         32, FALSE, 1, 1, SetResampleRate, 0 },
+    { &prop_softbutton_areas,      32, FALSE, SOFTBUTTON_AREAS * 4, SOFTBUTTON_AREAS * 4,
+                                                    SetSoftButtonAreas, 0 },
+};
+
+#define PROP_HASH_SIZE 128              /* power of two, well above the handler count */
+
+/* handlers by atom, open addressing; atoms are handed out in sequence so
+ * their low bits spread well */
+static const PropHandler *prop_hash[PROP_HASH_SIZE];
+
+static void
+InitPropHandlers(void)
+{
+    int i;
+
+    memset(prop_hash, 0, sizeof(prop_hash));
+    for (i = 0; i < sizeof(prop_handlers) / sizeof(prop_handlers[0]); i++)
+    {
+        Atom atom = *prop_handlers[i].atom;
+        unsigned int h;
+
+        /* not created for this device, e.g. without scroll buttons */
+        if (atom == None)
+            continue;
+
+        for (h = atom & (PROP_HASH_SIZE - 1); prop_hash[h];
+             h = (h + 1) & (PROP_HASH_SIZE - 1))
+            ;
+        prop_hash[h] = &prop_handlers[i];
+    }
+}
+
+static const PropHandler *
+LookupPropHandler(Atom property)
+{
+    unsigned int h;
+
+    for (h = property & (PROP_HASH_SIZE - 1); prop_hash[h];
+         h = (h + 1) & (PROP_HASH_SIZE - 1))
+        if (*prop_hash[h]->atom == property)
+            return prop_hash[h];
+
+    return NULL;
+}
+
+int
+SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
+            BOOL checkonly)
+{
+    InputInfoPtr pInfo = dev->public.devicePrivate;
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    SynapticsParameters *para = &priv->synpara;
+    SynapticsParameters tmp;
+    const PropHandler *handler;
+    int rc;
+
+    handler = LookupPropHandler(property);
+    if (!handler)
+        return Success;
+
+    /* read-only */
+    if (!handler->set)
+        return BadValue;
+
+    if (prop->size < handler->min_size || prop->size > handler->max_size ||
+        prop->format != handler->format ||
+        prop->type != (handler->is_float ? float_type : XA_INTEGER))
+        return BadMatch;
+
+    /* If checkonly is set, no parameters may be changed. So just let the code
+     * change temporary variables and forget about it. */
+    if (checkonly)
+    {
+        tmp = *para;
+        para = &tmp;
+    }
+
+    rc = handler->set(priv, para, prop);
+    if (rc != Success || checkonly)
+        return rc;
+
+    /* the frame path only reads the compiled block, hand it the change */
+    SynapticsCompileParams(priv);
+#ifdef HAVE_SMOOTH_SCROLL
+    if (handler->rebuild & REBUILD_SCROLL)
+        SynapticsSetScrollValuators(pInfo);
+#endif
+
+    return Success;
+}
@@ -383,6 +383,16 @@ PS2DeviceOffHook(InputInfoPtr pInfo)
     ps2_synaptics_enable_device(pInfo->fd);
 }
 
+static int
+PS2DevicePreInitHook(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *)pInfo->private;
+
+    /* PS2QueryHardware() allocates the hardware info */
+    arena_reserve(&priv->arena, sizeof(struct SynapticsHwInfo));
+    return Success;
+}
+
 static Bool
 PS2QueryHardware(InputInfoPtr pInfo)
 {
@@ -391,7 +401,7 @@ PS2QueryHardware(InputInfoPtr pInfo)
     struct SynapticsHwInfo *synhw;
 
     if (!priv->proto_data)
-        priv->proto_data = calloc(1, sizeof(struct SynapticsHwInfo));
+        priv->proto_data = arena_alloc(&priv->arena, sizeof(struct SynapticsHwInfo));
     synhw = (struct SynapticsHwInfo*)priv->proto_data;
 
     /* is the synaptics touchpad active? */
@@ -523,15 +533,15 @@ ps2_synaptics_get_packet(InputInfoPtr pInfo, struct SynapticsHwInfo *synhw,
 static Bool
 PS2ReadHwState(InputInfoPtr pInfo,
 	       struct SynapticsProtocolOperations *proto_ops,
-	       struct CommData *comm, struct SynapticsHwState *hwRet)
+	       struct CommData *comm)
 {
     unsigned char *buf = comm->protoBuf;
     struct SynapticsHwState *hw = &(comm->hwState);
     SynapticsPrivate *priv = (SynapticsPrivate *)pInfo->private;
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     struct SynapticsHwInfo *synhw;
     int newabs;
-    int w, i;
+    int w;
 
     synhw = (struct SynapticsHwInfo*)priv->proto_data;
     if (!synhw)
@@ -550,8 +560,7 @@ PS2ReadHwState(InputInfoPtr pInfo,
     /* Handle normal packets */
     hw->x = hw->y = hw->z = hw->numFingers = hw->fingerWidth = 0;
     hw->left = hw->right = hw->up = hw->down = hw->middle = FALSE;
-    for (i = 0; i < 8; i++)
-	hw->multi[i] = FALSE;
+    hw->multi = 0;
 
     if (newabs) {			    /* newer protos...*/
 	DBG(7, "using new protocols\n");
@@ -588,17 +597,17 @@ PS2ReadHwState(InputInfoPtr pInfo,
 		    default:
 			break;
 		    case 8:
-			hw->multi[7] = ((buf[5] & 0x08)) ? 1 : 0;
-			hw->multi[6] = ((buf[4] & 0x08)) ? 1 : 0;
+			hw->multi |= ((buf[5] & 0x08)) ? 1 << 7 : 0;
+			hw->multi |= ((buf[4] & 0x08)) ? 1 << 6 : 0;
 		    case 6:
-			hw->multi[5] = ((buf[5] & 0x04)) ? 1 : 0;
-			hw->multi[4] = ((buf[4] & 0x04)) ? 1 : 0;
+			hw->multi |= ((buf[5] & 0x04)) ? 1 << 5 : 0;
+			hw->multi |= ((buf[4] & 0x04)) ? 1 << 4 : 0;
 		    case 4:
-			hw->multi[3] = ((buf[5] & 0x02)) ? 1 : 0;
-			hw->multi[2] = ((buf[4] & 0x02)) ? 1 : 0;
+			hw->multi |= ((buf[5] & 0x02)) ? 1 << 3 : 0;
+			hw->multi |= ((buf[4] & 0x02)) ? 1 << 2 : 0;
 		    case 2:
-			hw->multi[1] = ((buf[5] & 0x01)) ? 1 : 0;
-			hw->multi[0] = ((buf[4] & 0x01)) ? 1 : 0;
+			hw->multi |= ((buf[5] & 0x01)) ? 1 << 1 : 0;
+			hw->multi |= ((buf[4] & 0x01)) ? 1 << 0 : 0;
 		    }
 		}
 	    }
@@ -656,7 +665,6 @@ PS2ReadHwState(InputInfoPtr pInfo,
 	}
     }
 
-    *hwRet = *hw;
     return TRUE;
 }
 
@@ -667,7 +675,7 @@ PS2AutoDevProbe(InputInfoPtr pInfo)
 }
 
 struct SynapticsProtocolOperations psaux_proto_operations = {
-    NULL,
+    PS2DevicePreInitHook,
     NULL,
     NULL,
     PS2DeviceOffHook,
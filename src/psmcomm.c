@@ -143,7 +143,7 @@ PSMQueryHardware(InputInfoPtr pInfo)
     priv = (SynapticsPrivate *)pInfo->private;
 
     if(!priv->proto_data)
-        priv->proto_data = calloc(1, sizeof(struct SynapticsHwInfo));
+        priv->proto_data = arena_alloc(&priv->arena, sizeof(struct SynapticsHwInfo));
     synhw = (struct SynapticsHwInfo*)priv->proto_data;
 
     /* is the synaptics touchpad active? */
@@ -165,9 +165,9 @@ PSMQueryHardware(InputInfoPtr pInfo)
 static Bool
 PSMReadHwState(InputInfoPtr pInfo,
 	       struct SynapticsProtocolOperations *proto_ops,
-	       struct CommData *comm, struct SynapticsHwState *hwRet)
+	       struct CommData *comm)
 {
-    return psaux_proto_operations.ReadHwState(pInfo, proto_ops, comm, hwRet);
+    return psaux_proto_operations.ReadHwState(pInfo, proto_ops, comm);
 }
 
 static Bool PSMAutoDevProbe(InputInfoPtr pInfo)
@@ -65,7 +65,11 @@
 #include <xf86.h>
 #include <sys/shm.h>
 #include <math.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <xf86_OSproc.h>
 #include <xf86Xinput.h>
 #include <exevents.h>
@@ -81,16 +85,17 @@
 #endif
 
 #include "synhist.h"
+#include "circscroll.h"
 #include "yolog.h"
 
 YOLOG_STATIC_INIT("synaptics.c", YOLOG_DEBUG);
 
 typedef enum {
     NO_EDGE = 0,
-    BOTTOM_EDGE = 1,
-    TOP_EDGE = 2,
-    LEFT_EDGE = 4,
-    RIGHT_EDGE = 8,
+    BOTTOM_EDGE = ZONE_BOTTOM_EDGE,
+    TOP_EDGE = ZONE_TOP_EDGE,
+    LEFT_EDGE = ZONE_LEFT_EDGE,
+    RIGHT_EDGE = ZONE_RIGHT_EDGE,
     LEFT_BOTTOM_EDGE = BOTTOM_EDGE | LEFT_EDGE,
     RIGHT_BOTTOM_EDGE = BOTTOM_EDGE | RIGHT_EDGE,
     RIGHT_TOP_EDGE = TOP_EDGE | RIGHT_EDGE,
@@ -107,10 +112,6 @@ typedef enum {
 #define M_PI 3.14159265358979323846
 #endif
 
-#ifndef M_SQRT1_2
-#define M_SQRT1_2  0.70710678118654752440  /* 1/sqrt(2) */
-#endif
-
 #define INPUT_BUFFER_SIZE 200
 
 /*****************************************************************************
@@ -133,7 +134,11 @@ static Bool DeviceClose(DeviceIntPtr);
 static Bool QueryHardware(InputInfoPtr);
 static void ReadDevDimensions(InputInfoPtr);
 static void ScaleCoordinates(SynapticsPrivate *priv, struct SynapticsHwState *hw);
-static void CalculateScalingCoeffs(SynapticsPrivate *priv);
+static int kinetic_tick(InputInfoPtr pInfo, int now);
+static void scroll_reset(SynapticsPrivate *priv);
+static void log_stage_stats(InputInfoPtr pInfo);
+static int idle_tick(InputInfoPtr pInfo, int now, Bool *posted);
+static Bool idle_tick_pending(SynapticsPrivate *priv);
 
 void InitDeviceProperties(InputInfoPtr pInfo);
 int SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
@@ -164,6 +169,8 @@ static XF86ModuleVersionInfo VersionRec = {
 static pointer
 SetupProc(pointer module, pointer options, int *errmaj, int *errmin)
 {
+    /* before any message comes from the SIGIO handler */
+    yobot_log_init();
     xf86AddInputDriver(&SYNAPTICS, module, 0);
     return module;
 }
@@ -324,7 +331,7 @@ alloc_shm_data(InputInfoPtr pInfo)
 	    return FALSE;
 	}
     } else {
-	priv->synshm = calloc(1, sizeof(SynapticsSHM));
+	priv->synshm = arena_alloc(&priv->arena, sizeof(SynapticsSHM));
 	if (!priv->synshm)
 	    return FALSE;
     }
@@ -343,14 +350,13 @@ free_shm_data(SynapticsPrivate *priv)
     if (!priv->synshm)
 	return;
 
+    /* without SHMConfig it is part of the arena and kept for the next
+     * DeviceInit */
     if (priv->shm_config) {
 	if ((shmid = shmget(SHM_SYNAPTICS, 0, 0)) != -1)
 	    shmctl(shmid, IPC_RMID, NULL);
-    } else {
-	free(priv->synshm);
+	priv->synshm = NULL;
     }
-
-    priv->synshm = NULL;
 }
 
 static void
@@ -410,6 +416,103 @@ static int set_percent_option(pointer options, const char* optname,
     return result;
 }
 
+/*
+ * Parse an acceleration curve of the form "velocity factor factor ...": the
+ * factors are spread evenly over the velocities from 0 to the given velocity.
+ * Returns the number of values in the curve or 0 if the curve is invalid.
+ */
+static int
+parse_accel_curve(InputInfoPtr pInfo, const char *str, float *curve)
+{
+    char *end;
+    int i, n = 0;
+
+    if (!str)
+	return 0;
+
+    while (n < SYN_ACCEL_CURVE_MAX) {
+	double val = strtod(str, &end);
+	if (end == str)
+	    break;
+	curve[n++] = val;
+	str = end;
+    }
+
+    for (i = 0; i < n; i++)
+	if (curve[i] < 0)
+	    break;
+
+    if (n < 3 || curve[0] <= 0 || i < n) {
+	xf86Msg(X_WARNING, "%s: invalid AccelCurve, using built-in curve\n",
+		pInfo->name);
+	return 0;
+    }
+
+    return n;
+}
+
+/* the value of an open edge: left and top edges come first in an area */
+#define SOFTBUTTON_OPEN(edge) ((edge) % 2 ? INT_MAX : INT_MIN)
+
+/*
+ * Parse soft button areas of the form "RBL RBR RBT RBB MBL MBR MBT MBB":
+ * left, right, top and bottom edge of the right and of the middle button
+ * area. A value ending in % is relative to the pad size, * leaves an edge
+ * open. Invalid areas are reported and switched off.
+ */
+static void
+parse_softbutton_areas(InputInfoPtr pInfo, const char *str,
+		       int areas[SOFTBUTTON_AREAS][4])
+{
+    SynapticsPrivate *priv = pInfo->private;
+    int values[SOFTBUTTON_AREAS * 4];
+    char *end;
+    int i;
+
+    for (i = 0; i < SOFTBUTTON_AREAS * 4; i++)
+	areas[i / 4][i % 4] = SOFTBUTTON_OPEN(i);
+    if (!str)
+	return;
+
+    for (i = 0; i < SOFTBUTTON_AREAS * 4; i++) {
+	double val;
+
+	while (*str == ' ' || *str == '\t')
+	    str++;
+	if (*str == '*') {
+	    values[i] = SOFTBUTTON_OPEN(i);
+	    str++;
+	    continue;
+	}
+	val = strtod(str, &end);
+	if (end == str)
+	    break;
+	if (*end == '%') {
+	    if (i % 4 < 2)
+		val = priv->minx + val / 100.0 * (priv->maxx - priv->minx);
+	    else
+		val = priv->miny + val / 100.0 * (priv->maxy - priv->miny);
+	    end++;
+	}
+	values[i] = val;
+	str = end;
+    }
+
+    if (i < SOFTBUTTON_AREAS * 4)
+	goto fail;
+
+    for (i = 0; i < SOFTBUTTON_AREAS * 4; i += 2)
+	if (values[i] > values[i + 1])
+	    goto fail;
+
+    memcpy(areas, values, sizeof(values));
+    return;
+
+fail:
+    xf86Msg(X_WARNING, "%s: invalid SoftButtonAreas, soft buttons disabled\n",
+	    pInfo->name);
+}
+
 static void set_default_parameters(InputInfoPtr pInfo)
 {
     SynapticsPrivate *priv = pInfo->private; /* read-only */
@@ -427,6 +530,7 @@ static void set_default_parameters(InputInfoPtr pInfo)
     int edgeMotionMinZ, edgeMotionMaxZ;			/* pressure */
     int pressureMotionMinZ, pressureMotionMaxZ;		/* pressure */
     int palmMinWidth, palmMinZ;				/* pressure */
+    int thumbMinMajor, palmMinMajor;			/* touch major */
     int tapButton1, tapButton2, tapButton3;
     int clickFinger1, clickFinger2, clickFinger3;
     Bool vertEdgeScroll, horizEdgeScroll;
@@ -435,6 +539,7 @@ static void set_default_parameters(InputInfoPtr pInfo)
     int vertResolution = 1;
     int width, height, diag, range;
     int horizHyst, vertHyst;
+    int i;
 
     /* read the parameters */
     if (priv->synshm)
@@ -489,6 +594,11 @@ static void set_default_parameters(InputInfoPtr pInfo)
     palmMinWidth = priv->minw + range * (10.0/16);
     emulateTwoFingerMinW = priv->minw + range * (7.0/16);
 
+    /* 0 leaves per-contact classification off on devices without touch major */
+    range = priv->max_major - priv->min_major;
+    thumbMinMajor = range > 0 ? priv->min_major + range * 0.35 : 0;
+    palmMinMajor = range > 0 ? priv->min_major + range * 0.6 : 0;
+
     /* Enable tap */
     tapButton1 = 1;
     tapButton2 = 2;
@@ -571,12 +681,45 @@ static void set_default_parameters(InputInfoPtr pInfo)
     pars->click_action[F1_CLICK1] = xf86SetIntOption(opts, "ClickFinger1", clickFinger1);
     pars->click_action[F2_CLICK1] = xf86SetIntOption(opts, "ClickFinger2", clickFinger2);
     pars->click_action[F3_CLICK1] = xf86SetIntOption(opts, "ClickFinger3", clickFinger3);
+    pars->gesture_action[SWIPE3_LEFT] = xf86SetIntOption(opts, "Swipe3LeftButton", 0);
+    pars->gesture_action[SWIPE3_RIGHT] = xf86SetIntOption(opts, "Swipe3RightButton", 0);
+    pars->gesture_action[SWIPE3_UP] = xf86SetIntOption(opts, "Swipe3UpButton", 0);
+    pars->gesture_action[SWIPE3_DOWN] = xf86SetIntOption(opts, "Swipe3DownButton", 0);
+    pars->gesture_action[SWIPE4_LEFT] = xf86SetIntOption(opts, "Swipe4LeftButton", 0);
+    pars->gesture_action[SWIPE4_RIGHT] = xf86SetIntOption(opts, "Swipe4RightButton", 0);
+    pars->gesture_action[SWIPE4_UP] = xf86SetIntOption(opts, "Swipe4UpButton", 0);
+    pars->gesture_action[SWIPE4_DOWN] = xf86SetIntOption(opts, "Swipe4DownButton", 0);
+    pars->gesture_action[PINCH_IN] = xf86SetIntOption(opts, "PinchInButton", 0);
+    pars->gesture_action[PINCH_OUT] = xf86SetIntOption(opts, "PinchOutButton", 0);
+    pars->gesture_action[ROTATE_CW] = xf86SetIntOption(opts, "RotateCWButton", 0);
+    pars->gesture_action[ROTATE_CCW] = xf86SetIntOption(opts, "RotateCCWButton", 0);
+    pars->gesture_key[SWIPE3_LEFT] = xf86SetIntOption(opts, "Swipe3LeftKey", 0);
+    pars->gesture_key[SWIPE3_RIGHT] = xf86SetIntOption(opts, "Swipe3RightKey", 0);
+    pars->gesture_key[SWIPE3_UP] = xf86SetIntOption(opts, "Swipe3UpKey", 0);
+    pars->gesture_key[SWIPE3_DOWN] = xf86SetIntOption(opts, "Swipe3DownKey", 0);
+    pars->gesture_key[SWIPE4_LEFT] = xf86SetIntOption(opts, "Swipe4LeftKey", 0);
+    pars->gesture_key[SWIPE4_RIGHT] = xf86SetIntOption(opts, "Swipe4RightKey", 0);
+    pars->gesture_key[SWIPE4_UP] = xf86SetIntOption(opts, "Swipe4UpKey", 0);
+    pars->gesture_key[SWIPE4_DOWN] = xf86SetIntOption(opts, "Swipe4DownKey", 0);
+    pars->gesture_key[PINCH_IN] = xf86SetIntOption(opts, "PinchInKey", 0);
+    pars->gesture_key[PINCH_OUT] = xf86SetIntOption(opts, "PinchOutKey", 0);
+    pars->gesture_key[ROTATE_CW] = xf86SetIntOption(opts, "RotateCWKey", 0);
+    pars->gesture_key[ROTATE_CCW] = xf86SetIntOption(opts, "RotateCCWKey", 0);
+    for (i = 0; i < MAX_GESTURE; i++)
+	if (pars->gesture_key[i] < SYN_MIN_KEYCODE || pars->gesture_key[i] > SYN_MAX_KEYCODE)
+	    pars->gesture_key[i] = 0;
     pars->circular_scrolling = xf86SetBoolOption(opts, "CircularScrolling", FALSE);
     pars->circular_trigger   = xf86SetIntOption(opts, "CircScrollTrigger", 0);
     pars->circular_pad       = xf86SetBoolOption(opts, "CircularPad", FALSE);
     pars->palm_detect        = xf86SetBoolOption(opts, "PalmDetect", FALSE);
     pars->palm_min_width     = xf86SetIntOption(opts, "PalmMinWidth", palmMinWidth);
     pars->palm_min_z         = xf86SetIntOption(opts, "PalmMinZ", palmMinZ);
+    pars->thumb_min_major    = set_percent_option(opts, "ThumbMinTouchMajor",
+                                                  priv->max_major - priv->min_major,
+                                                  priv->min_major, thumbMinMajor);
+    pars->palm_min_major     = set_percent_option(opts, "PalmMinTouchMajor",
+                                                  priv->max_major - priv->min_major,
+                                                  priv->min_major, palmMinMajor);
     pars->single_tap_timeout = xf86SetIntOption(opts, "SingleTapTimeout", 180);
     pars->press_motion_min_z = xf86SetIntOption(opts, "PressureMotionMinZ", pressureMotionMinZ);
     pars->press_motion_max_z = xf86SetIntOption(opts, "PressureMotionMaxZ", pressureMotionMaxZ);
@@ -589,12 +732,24 @@ static void set_default_parameters(InputInfoPtr pInfo)
     pars->scroll_dist_circ = xf86SetRealOption(opts, "CircScrollDelta", 0.1);
     pars->coasting_speed = xf86SetRealOption(opts, "CoastingSpeed", 20.0);
     pars->coasting_friction = xf86SetRealOption(opts, "CoastingFriction", 50);
+    pars->coasting_decay = xf86SetRealOption(opts, "CoastingDecay", 0);
     pars->press_motion_min_factor = xf86SetRealOption(opts, "PressureMotionMinFactor", 1.0);
     pars->press_motion_max_factor = xf86SetRealOption(opts, "PressureMotionMaxFactor", 1.0);
     pars->grab_event_device = xf86SetBoolOption(opts, "GrabEventDevice", TRUE);
     pars->tap_and_drag_gesture = xf86SetBoolOption(opts, "TapAndDragGesture", TRUE);
     pars->resolution_horiz = xf86SetIntOption(opts, "HorizResolution", horizResolution);
     pars->resolution_vert = xf86SetIntOption(opts, "VertResolution", vertResolution);
+    pars->predict_horizon = xf86SetRealOption(opts, "PredictionHorizon", 0.0);
+    pars->predict_damping = xf86SetRealOption(opts, "PredictionDamping", 0.5);
+    pars->predict_horizon = MAX(pars->predict_horizon, 0);
+    pars->predict_damping = MAX(0, MIN(pars->predict_damping, 0.99));
+    pars->resample_rate = xf86SetIntOption(opts, "ResampleRate", 0);
+    pars->resample_rate = MAX(0, MIN(pars->resample_rate, 1000));
+    pars->accel_curve_len = parse_accel_curve(pInfo,
+					      xf86SetStrOption(opts, "AccelCurve", NULL),
+					      pars->accel_curve);
+    parse_softbutton_areas(pInfo, xf86SetStrOption(opts, "SoftButtonAreas", NULL),
+			   pars->softbutton_areas);
 
     /* Warn about (and fix) incorrectly configured TopEdge/BottomEdge parameters */
     if (pars->top_edge > pars->bottom_edge) {
@@ -606,6 +761,261 @@ static void set_default_parameters(InputInfoPtr pInfo)
     }
 }
 
+/*
+ * Copy the soft button areas into the compiled parameters, where an area
+ * that is off gets empty bounds so get_button_zone() only compares. An
+ * area with all edges open is off.
+ */
+static void
+build_button_zones(SynapticsCompiledParams *cp)
+{
+    SynapticsParameters *para = &cp->para;
+    int i;
+
+    cp->has_button_zones = FALSE;
+    cp->zones.button_band_top = INT_MAX;
+
+    for (i = 0; i < SOFTBUTTON_AREAS; i++) {
+	const int *area = para->softbutton_areas[i];
+	int *zone = cp->zones.button_zone[i];
+
+	if (area[0] == INT_MIN && area[1] == INT_MAX &&
+	    area[2] == INT_MIN && area[3] == INT_MAX) {
+	    zone[0] = zone[2] = INT_MAX;
+	    zone[1] = zone[3] = INT_MIN;
+	    continue;
+	}
+
+	memcpy(zone, area, sizeof(cp->zones.button_zone[i]));
+	cp->zones.button_band_top = MIN(cp->zones.button_band_top, zone[2]);
+	cp->has_button_zones = TRUE;
+    }
+}
+
+/*
+ * Copy the edges and the active area into the zone bounds next to the
+ * button zones and map them over the device range.
+ */
+static void
+build_zones(SynapticsPrivate *priv, SynapticsCompiledParams *cp)
+{
+    const SynapticsParameters *para = &cp->para;
+    ZoneMap *z = &cp->zones;
+
+    z->left_edge = para->left_edge;
+    z->right_edge = para->right_edge;
+    z->top_edge = para->top_edge;
+    z->bottom_edge = para->bottom_edge;
+    z->circular = para->circular_pad;
+    z->center_x = (para->left_edge + para->right_edge) / 2.0;
+    z->center_y = (para->top_edge + para->bottom_edge) / 2.0;
+    if ((para->right_edge > z->center_x) && (para->bottom_edge > z->center_y)) {
+	z->inv_half_x = 1.0 / (para->right_edge - z->center_x);
+	z->inv_half_y = 1.0 / (para->bottom_edge - z->center_y);
+    } else {
+	z->inv_half_x = 0;
+	z->inv_half_y = 0;
+    }
+
+    z->area_left_edge = para->area_left_edge;
+    z->area_right_edge = para->area_right_edge;
+    z->area_top_edge = para->area_top_edge;
+    z->area_bottom_edge = para->area_bottom_edge;
+
+    zone_map_build(z, priv->minx, priv->maxx, priv->miny, priv->maxy);
+}
+
+/*
+ * Precompute the acceleration profile. The velocity -> factor curve (either
+ * the built-in linear one or a user supplied curve) is sampled into
+ * accel_table and the pressure -> factor ramp into press_table, so that
+ * SynapticsAccelerationProfile only interpolates between two table entries.
+ */
+static void
+build_accel_table(SynapticsCompiledParams *cp)
+{
+    SynapticsParameters *para = &cp->para;
+    double vmax;
+    int i;
+
+    if (para->accel_curve_len >= 3) {
+	/* user curve: factors evenly spaced between velocity 0 and vmax */
+	const float *factors = para->accel_curve + 1;
+	int nfactors = para->accel_curve_len - 1;
+
+	vmax = para->accel_curve[0];
+	for (i = 0; i <= SYN_ACCEL_TABLE_SIZE; i++) {
+	    double pos = (double)i * (nfactors - 1) / SYN_ACCEL_TABLE_SIZE;
+	    int j = MIN((int)pos, nfactors - 2);
+
+	    cp->accel_table[i] = factors[j] + (pos - j) * (factors[j + 1] - factors[j]);
+	}
+	cp->accel_table_slope = 0;
+    } else {
+	/* speed up linear with finger velocity. The table covers four times
+	 * the range up to max_speed and is extrapolated beyond that. The
+	 * upper clip depends on the dix acceleration and is done on lookup. */
+	vmax = (para->accl > 0 && para->max_speed > 0) ?
+	       4 * para->max_speed / para->accl : 1;
+	for (i = 0; i <= SYN_ACCEL_TABLE_SIZE; i++)
+	    cp->accel_table[i] = MAX(vmax * i / SYN_ACCEL_TABLE_SIZE * para->accl,
+				       para->min_speed);
+	cp->accel_table_slope = vmax / SYN_ACCEL_TABLE_SIZE * para->accl;
+    }
+
+    cp->accel_table_step = vmax / SYN_ACCEL_TABLE_SIZE;
+
+    /* modify speed according to pressure */
+    for (i = 0; i <= SYN_PRESSURE_BUCKETS; i++)
+	cp->press_table[i] = para->press_motion_min_factor +
+			       (para->press_motion_max_factor - para->press_motion_min_factor) *
+			       i / SYN_PRESSURE_BUCKETS;
+
+    if (para->press_motion_max_z > para->press_motion_min_z)
+	cp->press_table_scale = (double)SYN_PRESSURE_BUCKETS /
+				  (para->press_motion_max_z - para->press_motion_min_z);
+    else
+	cp->press_table_scale = 0;
+}
+
+static void
+add_stage(SynapticsCompiledParams *cp, enum SynapticsStage stage, Bool enabled)
+{
+    if (enabled)
+	cp->stages[cp->num_stages++] = stage;
+}
+
+static Bool
+has_stage(const SynapticsCompiledParams *cp, enum SynapticsStage stage)
+{
+    int i;
+
+    for (i = 0; i < cp->num_stages; i++)
+	if (cp->stages[i] == stage)
+	    return TRUE;
+    return FALSE;
+}
+
+/* whether a recognised gesture would click a button or press a key */
+static Bool
+gestures_configured(SynapticsPrivate *priv, const SynapticsParameters *para)
+{
+    int i;
+
+    for (i = 0; i < MAX_GESTURE; i++)
+	if (para->gesture_action[i] || (priv->has_gesture_keys && para->gesture_key[i]))
+	    return TRUE;
+    return FALSE;
+}
+
+/*
+ * Lay out the HandleState pipeline: the stages in the order they run,
+ * leaving out the ones the configuration turns into no-ops.
+ */
+static void
+build_stages(SynapticsPrivate *priv, SynapticsCompiledParams *cp)
+{
+    const SynapticsParameters *para = &cp->para;
+    Bool scrolling = para->scroll_twofinger_vert || para->scroll_twofinger_horiz ||
+		     para->scroll_edge_vert || para->scroll_edge_horiz ||
+		     para->scroll_edge_corner || para->circular_scrolling;
+    Bool edge_motion = (para->edge_motion_use_always || para->tap_and_drag_gesture) &&
+		       (para->edge_motion_min_speed || para->edge_motion_max_speed);
+
+    cp->num_stages = 0;
+    if (para->touchpad_off == 1)
+	return;
+
+    add_stage(cp, STAGE_HYSTERESIS, para->hyst_x > 0 || para->hyst_y > 0);
+    add_stage(cp, STAGE_AREA, para->area_left_edge || para->area_right_edge ||
+			      para->area_top_edge || para->area_bottom_edge);
+    add_stage(cp, STAGE_MIDBUTTON, para->emulate_mid_button_time > 0);
+    add_stage(cp, STAGE_BUTTONS, TRUE);
+    add_stage(cp, STAGE_SCROLLBUTTONS, priv->has_scrollbuttons);
+    add_stage(cp, STAGE_EDGES, para->scroll_edge_vert || para->scroll_edge_horiz ||
+			       para->scroll_edge_corner || para->circular_scrolling ||
+			       edge_motion);
+    add_stage(cp, STAGE_FINGER, TRUE);
+    add_stage(cp, STAGE_TAP, TRUE);
+    add_stage(cp, STAGE_SCROLL, scrolling && para->touchpad_off != 2);
+    add_stage(cp, STAGE_SCALE, cp->horiz_coeff != 1 || cp->vert_coeff != 1);
+    add_stage(cp, STAGE_DELTAS, !priv->absolute_events);
+    add_stage(cp, STAGE_POST, TRUE);
+    add_stage(cp, STAGE_GESTURES, para->touchpad_off != 2 && gestures_configured(priv, para));
+}
+
+/*
+ * Build the parameter block the frame path reads: a snapshot of synpara and
+ * everything derived from it. The block not in use is rebuilt and swapped in
+ * with SIGIO blocked, so a frame sees either the old or the new
+ * configuration, never a mix. Must be called whenever synpara changes.
+ */
+void
+SynapticsCompileParams(SynapticsPrivate *priv)
+{
+    SynapticsCompiledParams *cp = (priv->cp == &priv->compiled[0]) ?
+				  &priv->compiled[1] : &priv->compiled[0];
+    SynapticsParameters *para = &cp->para;
+    int hres, vres;
+    int sigstate;
+
+    *para = priv->synpara;
+
+    build_accel_table(cp);
+    build_button_zones(cp);
+
+    /* square the pad off when the axes have a different resolution */
+    hres = para->resolution_horiz;
+    vres = para->resolution_vert;
+    cp->horiz_coeff = 1;
+    cp->vert_coeff = 1;
+    if ((hres > vres) && (hres > 0))
+	cp->horiz_coeff = vres / (double)hres;
+    else if ((hres < vres) && (vres > 0))
+	cp->vert_coeff = hres / (double)vres;
+    cp->scale_center_x = (para->left_edge + para->right_edge) / 2;
+    cp->scale_center_y = (para->top_edge + para->bottom_edge) / 2;
+
+
+    cp->scroll_repeat_delay = MAX(SBR_MIN, MIN(para->scroll_button_repeat, SBR_MAX));
+    cp->resample_period = (para->resample_rate > 0) ?
+			  MAX((int)(1000.0 / para->resample_rate + 0.5), 1) : 0;
+    cp->circ_inv_delta = (para->scroll_dist_circ > 0) ? 1.0 / para->scroll_dist_circ : 0;
+    cp->coasting_speed_sq = SQR(para->coasting_speed);
+    cp->coasting_tau = para->coasting_decay / 1000.0;
+
+    build_zones(priv, cp);
+    build_stages(priv, cp);
+    cp->time_stages = xf86GetVerbosity() >= 4;
+
+    sigstate = xf86BlockSIGIO();
+    priv->cp = cp;
+    /* a scroll stage left out can't end a scroll that is in progress */
+    if (!has_stage(cp, STAGE_SCROLL))
+	scroll_reset(priv);
+    xf86UnblockSIGIO(sigstate);
+}
+
+#ifdef HAVE_SMOOTH_SCROLL
+/*
+ * Scroll valuators are posted in device units, so one scroll step is one
+ * scroll distance. A distance of 0 disables scrolling on that axis.
+ */
+void
+SynapticsSetScrollValuators(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    SynapticsParameters *para = &priv->synpara;
+
+    if (para->scroll_dist_horiz != 0)
+	SetScrollValuator(pInfo->dev, 2, SCROLL_TYPE_HORIZONTAL,
+			  para->scroll_dist_horiz, SCROLL_FLAG_NONE);
+    if (para->scroll_dist_vert != 0)
+	SetScrollValuator(pInfo->dev, 3, SCROLL_TYPE_VERTICAL,
+			  para->scroll_dist_vert, SCROLL_FLAG_PREFERRED);
+}
+#endif
+
 static float SynapticsAccelerationProfile(DeviceIntPtr dev,
                                           DeviceVelocityPtr vel,
                                           float velocity,
@@ -613,37 +1023,50 @@ static float SynapticsAccelerationProfile(DeviceIntPtr dev,
                                           float acc) {
     InputInfoPtr pInfo = dev->public.devicePrivate;
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters* para = &priv->synpara;
-
-    double accelfct;
+    const SynapticsCompiledParams *cp = priv->cp;
+    const SynapticsParameters *para = &cp->para;
+    const float *table = cp->accel_table;
+    double accelfct, pos;
+    int idx;
 
     /*
      * synaptics accel was originally base on device coordinate based
-     * velocity, which we recover this way so para->accl retains its scale.
+     * velocity, the table is indexed in these units so para->accl retains
+     * its scale. The constant deceleration may change at any time through
+     * the dix properties.
      */
-    velocity /= vel->const_acceleration;
+    if (vel->const_acceleration != priv->accel_const_acc || priv->accel_scale_cp != cp) {
+	priv->accel_const_acc = vel->const_acceleration;
+	priv->accel_scale_cp = cp;
+	priv->accel_table_scale = 1.0 / (cp->accel_table_step * vel->const_acceleration);
+    }
 
-    /* speed up linear with finger velocity */
-    accelfct = velocity * para->accl;
+    pos = MAX(velocity * priv->accel_table_scale, 0);
+    if (pos >= SYN_ACCEL_TABLE_SIZE) {
+	accelfct = table[SYN_ACCEL_TABLE_SIZE] +
+		   (pos - SYN_ACCEL_TABLE_SIZE) * cp->accel_table_slope;
+    } else {
+	idx = (int)pos;
+	accelfct = table[idx] + (pos - idx) * (table[idx + 1] - table[idx]);
+    }
 
-    /* clip acceleration factor */
-    if (accelfct > para->max_speed * acc)
+    /* clip acceleration factor, min_speed is already part of the table */
+    if (para->accel_curve_len == 0 && accelfct > para->max_speed * acc)
 	accelfct = para->max_speed * acc;
-    else if (accelfct < para->min_speed)
-	accelfct = para->min_speed;
 
     /* modify speed according to pressure */
     if (priv->moving_state == MS_TOUCHPAD_RELATIVE) {
-	int minZ = para->press_motion_min_z;
-	int maxZ = para->press_motion_max_z;
-	double minFctr = para->press_motion_min_factor;
-	double maxFctr = para->press_motion_max_factor;
-	if (priv->hwState.z <= minZ) {
-	    accelfct *= minFctr;
-	} else if (priv->hwState.z >= maxZ) {
-	    accelfct *= maxFctr;
+	int z = priv->comm.hwState.z;
+
+	if (z <= para->press_motion_min_z) {
+	    accelfct *= cp->press_table[0];
+	} else if (z >= para->press_motion_max_z) {
+	    accelfct *= cp->press_table[SYN_PRESSURE_BUCKETS];
 	} else {
-	    accelfct *= minFctr + (priv->hwState.z - minZ) * (maxFctr - minFctr) / (maxZ - minZ);
+	    pos = (z - para->press_motion_min_z) * cp->press_table_scale;
+	    idx = MIN((int)pos, SYN_PRESSURE_BUCKETS - 1);
+	    accelfct *= cp->press_table[idx] +
+			(pos - idx) * (cp->press_table[idx + 1] - cp->press_table[idx]);
 	}
     }
 
@@ -695,10 +1118,17 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
 {
     SynapticsPrivate *priv;
 
-    /* allocate memory for SynapticsPrivateRec */
-    priv = calloc(1, sizeof(SynapticsPrivate));
-    if (!priv)
+    /* allocate memory for SynapticsPrivateRec, the per-frame state at its
+     * start is laid out in cache lines */
+    if (posix_memalign((void **)&priv, SYN_CACHE_LINE, sizeof(SynapticsPrivate)))
 	return BadAlloc;
+    memset(priv, 0, sizeof(SynapticsPrivate));
+
+    /* one block for everything: the compiled parameters and the shm area
+     * here, the protocol adds what it probed in DevicePreInitHook */
+    arena_init(&priv->arena, 0);
+    arena_reserve(&priv->arena, 2 * sizeof(SynapticsCompiledParams));
+    arena_reserve(&priv->arena, sizeof(SynapticsSHM));
 
     pInfo->type_name               = XI_TOUCHPAD;
     pInfo->device_control          = DeviceControl;
@@ -733,6 +1163,8 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
     priv->tap_button = 0;
     priv->tap_button_state = TBS_BUTTON_UP;
     priv->touch_on.millis = 0;
+    priv->frame_time = SYNAPTICS_FRAME_TIME_DEFAULT;
+    priv->frame_time_applied = SYNAPTICS_FRAME_TIME_DEFAULT;
     priv->synpara.hyst_x = -1;
     priv->synpara.hyst_y = -1;
 
@@ -740,6 +1172,11 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
         if (priv->proto_ops->DevicePreInitHook(drv, pInfo, flags) != Success)
             goto SetupProc_fail;
 
+    /* the first arena block is sized now */
+    priv->compiled = arena_alloc(&priv->arena, 2 * sizeof(SynapticsCompiledParams));
+    if (!priv->compiled)
+	goto SetupProc_fail;
+
     /* read hardware dimensions */
     ReadDevDimensions(pInfo);
 
@@ -748,8 +1185,6 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
 
     set_default_parameters(pInfo);
 
-    CalculateScalingCoeffs(priv);
-
     if (!alloc_shm_data(pInfo))
 	goto SetupProc_fail;
 
@@ -760,6 +1195,8 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
 	goto SetupProc_fail;
     }
 
+    SynapticsCompileParams(priv);
+
     xf86ProcessCommonOptions(pInfo, pInfo->options);
 
     if (pInfo->fd != -1) {
@@ -782,7 +1219,7 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
     if (priv->comm.buffer)
 	XisbFree(priv->comm.buffer);
     free_shm_data(priv);
-    free(priv->proto_data);
+    arena_release(&priv->arena);
     free(priv->timer);
     free(priv);
     pInfo->private = NULL;
@@ -800,8 +1237,8 @@ static void SynapticsUnInit(InputDriverPtr drv,
     SynapticsPrivate *priv = ((SynapticsPrivate *)pInfo->private);
     if (priv && priv->timer)
         free(priv->timer);
-    if (priv && priv->proto_data)
-        free(priv->proto_data);
+    if (priv)
+        arena_release(&priv->arena);
     free(pInfo->private);
     pInfo->private = NULL;
     xf86DeleteInput(pInfo, 0);
@@ -882,6 +1319,9 @@ DeviceOn(DeviceIntPtr dev)
     xf86AddEnabledDevice(pInfo);
     dev->public.on = TRUE;
 
+    /* the arena refuses allocations from here until DeviceOff */
+    arena_seal(&priv->arena, TRUE);
+
     return Success;
 }
 
@@ -892,9 +1332,21 @@ DeviceOff(DeviceIntPtr dev)
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
 
     DBG(3, "Synaptics DeviceOff called\n");
+    log_stage_stats(pInfo);
+
+    arena_seal(&priv->arena, FALSE);
+    if (priv->arena.refused) {
+	xf86Msg(X_ERROR, "%s: %lu arena allocations while the device was on\n",
+		pInfo->name, priv->arena.refused);
+	priv->arena.refused = 0;
+    }
 
     if (pInfo->fd != -1) {
 	TimerCancel(priv->timer);
+	priv->timer_armed = FALSE;
+	priv->resample_active = FALSE;
+	kinetic_stop(&priv->kinetic);
+	gesture_reset(&priv->gesture);
 	xf86RemoveEnabledDevice(pInfo);
         if (priv->proto_ops->DeviceOffHook)
             priv->proto_ops->DeviceOffHook(pInfo);
@@ -923,6 +1375,9 @@ DeviceClose(DeviceIntPtr dev)
     TimerFree(priv->timer);
     priv->timer = NULL;
     free_shm_data(priv);
+#ifdef HAVE_SMOOTH_SCROLL
+    valuator_mask_free(&priv->scroll_events_mask);
+#endif
     return RetValue;
 }
 
@@ -933,6 +1388,10 @@ static void InitAxesLabels(Atom *labels, int nlabels)
     switch(nlabels)
     {
         default:
+        case 4:
+            labels[3] = XIGetKnownProperty(AXIS_LABEL_PROP_REL_WHEEL);
+        case 3:
+            labels[2] = XIGetKnownProperty(AXIS_LABEL_PROP_REL_HWHEEL);
         case 2:
             labels[1] = XIGetKnownProperty(AXIS_LABEL_PROP_REL_Y);
         case 1:
@@ -978,10 +1437,10 @@ DeviceInit(DeviceIntPtr dev)
     int min, max;
 #if GET_ABI_MAJOR(ABI_XINPUT_VERSION) >= 7
     Atom btn_labels[SYN_MAX_BUTTONS] = { 0 };
-    Atom axes_labels[2] = { 0 };
+    Atom axes_labels[SYN_NUM_AXES] = { 0 };
     DeviceVelocityPtr pVel;
 
-    InitAxesLabels(axes_labels, 2);
+    InitAxesLabels(axes_labels, SYN_NUM_AXES);
     InitButtonLabels(btn_labels, SYN_MAX_BUTTONS);
 #endif
 
@@ -998,12 +1457,23 @@ DeviceInit(DeviceIntPtr dev)
                             btn_labels,
 #endif
 			    SynapticsCtrl,
-			    GetMotionHistorySize(), 2
+			    GetMotionHistorySize(), SYN_NUM_AXES
 #if GET_ABI_MAJOR(ABI_XINPUT_VERSION) >= 7
                             , axes_labels
 #endif
 			    );
 
+#if GET_ABI_MAJOR(ABI_XINPUT_VERSION) >= 7
+    /* gesture keys need a key class, which can only be added now */
+    for (i = 0; i < MAX_GESTURE; i++)
+	if (priv->synpara.gesture_key[i])
+	    break;
+    if (i < MAX_GESTURE) {
+	priv->has_gesture_keys = InitKeyboardDeviceStruct(dev, NULL, NULL, NULL);
+	SynapticsCompileParams(priv); /* lay out the gesture stage for the keys */
+    }
+#endif
+
     /*
      * setup dix acceleration to match legacy synaptics settings, and
      * etablish a device-specific profile to do stuff like pressure-related
@@ -1030,10 +1500,12 @@ DeviceInit(DeviceIntPtr dev)
 	/* adjust accordingly */
 	priv->synpara.max_speed /= priv->synpara.min_speed;
 	priv->synpara.min_speed = 1.0;
+	SynapticsCompileParams(priv);
 
-	/* synaptics seems to report 80 packet/s, but dix scales for
-	 * 100 packet/s by default. */
-	pVel->corr_mul = 12.5f; /*1000[ms]/80[/s] = 12.5 */
+	/* dix scales for 100 packet/s by default. Start with the classic
+	 * synaptics rate of 80 packet/s, update_report_rate() adjusts this
+	 * once the real rate of the device is known. */
+	pVel->corr_mul = priv->frame_time; /* still SYNAPTICS_FRAME_TIME_DEFAULT here */
 
 	xf86Msg(X_CONFIG, "%s: MaxSpeed is now %.2f\n",
 		dev->name, priv->synpara.max_speed);
@@ -1091,6 +1563,17 @@ DeviceInit(DeviceIntPtr dev)
             );
     xf86InitValuatorDefaults(dev, 1);
 
+#ifdef HAVE_SMOOTH_SCROLL
+    /* scroll valuators */
+    xf86InitValuatorAxisStruct(dev, 2, axes_labels[2], 0, -1, 0, 0, 0, Relative);
+    xf86InitValuatorAxisStruct(dev, 3, axes_labels[3], 0, -1, 0, 0, 0, Relative);
+    SynapticsSetScrollValuators(pInfo);
+
+    priv->scroll_events_mask = valuator_mask_new(SYN_NUM_AXES);
+    if (!priv->scroll_events_mask)
+	return !Success;
+#endif
+
     if (!alloc_shm_data(pInfo))
 	return !Success;
 
@@ -1104,207 +1587,353 @@ DeviceInit(DeviceIntPtr dev)
 }
 
 
-/*
- * Convert from absolute X/Y coordinates to a coordinate system where
- * -1 corresponds to the left/upper edge and +1 corresponds to the
- * right/lower edge.
- */
-static void
-relative_coords(SynapticsPrivate *priv, int x, int y,
-		double *relX, double *relY)
-{
-    int minX = priv->synpara.left_edge;
-    int maxX = priv->synpara.right_edge;
-    int minY = priv->synpara.top_edge;
-    int maxY = priv->synpara.bottom_edge;
-    double xCenter = (minX + maxX) / 2.0;
-    double yCenter = (minY + maxY) / 2.0;
-
-    if ((maxX - xCenter > 0) && (maxY - yCenter > 0)) {
-	*relX = (x - xCenter) / (maxX - xCenter);
-	*relY = (y - yCenter) / (maxY - yCenter);
-    } else {
-	*relX = 0;
-	*relY = 0;
-    }
-}
-
 /* return angle of point relative to center */
 static double
 angle(SynapticsPrivate *priv, int x, int y)
 {
-    double xCenter = (priv->synpara.left_edge + priv->synpara.right_edge) / 2.0;
-    double yCenter = (priv->synpara.top_edge + priv->synpara.bottom_edge) / 2.0;
+    double xCenter = priv->cp->zones.center_x;
+    double yCenter = priv->cp->zones.center_y;
 
+#ifdef FAST_ATAN2
+    return circ_fast_atan2(-(y - yCenter), x - xCenter);
+#else
     return atan2(-(y - yCenter), x - xCenter);
-}
-
-/* return angle difference */
-static double
-diffa(double a1, double a2)
-{
-    double da = fmod(a2 - a1, 2 * M_PI);
-    if (da < 0)
-	da += 2 * M_PI;
-    if (da > M_PI)
-	da -= 2 * M_PI;
-    return da;
-}
-
-static edge_type
-circular_edge_detection(SynapticsPrivate *priv, int x, int y)
-{
-    edge_type edge = 0;
-    double relX, relY, relR;
-
-    relative_coords(priv, x, y, &relX, &relY);
-    relR = SQR(relX) + SQR(relY);
-
-    if (relR > 1) {
-	/* we are outside the ellipse enclosed by the edge parameters */
-	if (relX > M_SQRT1_2)
-	    edge |= RIGHT_EDGE;
-	else if (relX < -M_SQRT1_2)
-	    edge |= LEFT_EDGE;
-
-	if (relY < -M_SQRT1_2)
-	    edge |= TOP_EDGE;
-	else if (relY > M_SQRT1_2)
-	    edge |= BOTTOM_EDGE;
-    }
-
-    return edge;
+#endif
 }
 
 static edge_type
 edge_detection(SynapticsPrivate *priv, int x, int y)
 {
-    edge_type edge = NO_EDGE;
-
-    if (priv->synpara.circular_pad)
-	return circular_edge_detection(priv, x, y);
-
-    if (x > priv->synpara.right_edge)
-	edge |= RIGHT_EDGE;
-    else if (x < priv->synpara.left_edge)
-	edge |= LEFT_EDGE;
-
-    if (y < priv->synpara.top_edge)
-	edge |= TOP_EDGE;
-    else if (y > priv->synpara.bottom_edge)
-	edge |= BOTTOM_EDGE;
-
-    return edge;
+    return zone_edges(&priv->cp->zones, x, y);
 }
 
 /* Checks whether coordinates are in the Synaptics Area
  * or not. If no Synaptics Area is defined (i.e. if
- * priv->synpara.area_{left|right|top|bottom}_edge are
+ * area_{left|right|top|bottom}_edge are
  * all set to zero), the function returns TRUE.
  */
 Bool
 is_inside_active_area(SynapticsPrivate *priv, int x, int y)
 {
-    Bool inside_area = TRUE;
-
-    if ((priv->synpara.area_left_edge != 0) && (x < priv->synpara.area_left_edge))
-	inside_area = FALSE;
-    else if ((priv->synpara.area_right_edge != 0) && (x > priv->synpara.area_right_edge))
-	inside_area = FALSE;
-
-    if ((priv->synpara.area_top_edge != 0) && (y < priv->synpara.area_top_edge))
-	inside_area = FALSE;
-    else if ((priv->synpara.area_bottom_edge != 0) && (y > priv->synpara.area_bottom_edge))
-	inside_area = FALSE;
+    return zone_active(&priv->cp->zones, x, y);
+}
 
-    return inside_area;
+/*
+ * The button a click at x/y maps to on a clickpad with soft button areas:
+ * 3 or 2 inside the right or middle area, 1 elsewhere in the band the
+ * areas lie in and 0 above that band or if no areas are set up.
+ */
+int
+get_button_zone(SynapticsPrivate *priv, int x, int y)
+{
+    return zone_button(&priv->cp->zones, x, y);
 }
 
-CARD32
-timerFunc(OsTimerPtr timer, CARD32 now, pointer arg)
+/*
+ * Track the report rate of the device from the arrival times of hardware
+ * frames. All frames read in one batch carry the same timestamp, so the time
+ * since the previous batch is split over the frames read in this one. Gaps
+ * that are too long (finger lifted, device idle) or too short to be a real
+ * report interval are ignored.
+ */
+#define FRAME_TIME_MIN 2.0
+#define FRAME_TIME_MAX 50.0
+
+void
+update_report_rate(InputInfoPtr pInfo, int millis, int nframes)
 {
-    InputInfoPtr pInfo = arg;
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    struct SynapticsHwState hw;
-    int delay;
-    int sigstate;
-    CARD32 wakeUpTime;
-
-    sigstate = xf86BlockSIGIO();
+    double interval;
 
-    hw = priv->hwState;
-    hw.millis = now;
-    delay = HandleState(pInfo, &hw);
+    if (nframes <= 0)
+	return;
 
-    /*
-     * Workaround for wraparound bug in the TimerSet function. This bug is already
-     * fixed in CVS, but this driver needs to work with XFree86 versions 4.2.x and
-     * 4.3.x too.
-     */
-    wakeUpTime = now + delay;
-    if (wakeUpTime <= now)
-	wakeUpTime = 0xffffffffL;
+    if (priv->frame_millis) {
+	interval = TIME_DIFF(millis, priv->frame_millis) / (double)nframes;
+	if (interval >= FRAME_TIME_MIN && interval <= FRAME_TIME_MAX)
+	    priv->frame_time += (interval - priv->frame_time) / 8;
+    }
+    priv->frame_millis = millis;
 
-    priv->timer = TimerSet(priv->timer, TimerAbsolute, wakeUpTime, timerFunc, pInfo);
+    /* Only poke dix if the rate changed noticeably. */
+    if (fabs(priv->frame_time - priv->frame_time_applied) <
+	priv->frame_time_applied * 0.1)
+	return;
 
-    xf86UnblockSIGIO(sigstate);
+    priv->frame_time_applied = priv->frame_time;
+    DBG(7, "report rate now %.1f packets/s\n", 1000.0 / priv->frame_time);
+#if GET_ABI_MAJOR(ABI_XINPUT_VERSION) >= 7
+    if (pInfo->dev) {
+	DeviceVelocityPtr pVel = GetDevicePredictableAccelData(pInfo->dev);
+	if (pVel)
+	    pVel->corr_mul = priv->frame_time;
+    }
+#endif
+}
 
-    return 0;
+/* Timer period matching the report rate of the device, in ms. */
+static int
+frame_delay(SynapticsPrivate *priv)
+{
+    return MAX((int)(priv->frame_time + 0.5), 1);
 }
 
+/*
+ * Motion resampling. Instead of posting each frame's motion when it
+ * arrives, the pointer is moved linearly from where it was towards the new
+ * position over one frame time, on a fixed clock of ResampleRate ticks per
+ * second. This costs half a frame of latency on average but hides the
+ * jitter in the report cadence. The clock stops once the pointer has
+ * caught up.
+ */
 static int
-clamp(int val, int min, int max)
+resample_period(SynapticsPrivate *priv)
 {
-    if (val < min)
-	return min;
-    else if (val < max)
-	return val;
-    else
-	return max;
+    return priv->cp->resample_period;
 }
 
-static Bool
-SynapticsGetHwState(InputInfoPtr pInfo, SynapticsPrivate *priv,
-		    struct SynapticsHwState *hw)
+static double
+resample_progress(SynapticsPrivate *priv, int now)
 {
-    return priv->proto_ops->ReadHwState(pInfo, priv->proto_ops,
-					&priv->comm, hw);
+    double t = TIME_DIFF(now, priv->resample_millis) / priv->frame_time;
+
+    return MAX(0, MIN(t, 1));
 }
 
-/*
- *  called for each full received packet from the touchpad
- */
 static void
-ReadInput(InputInfoPtr pInfo)
+resample_push(SynapticsPrivate *priv, int dx, int dy, int millis)
 {
-    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    struct SynapticsHwState hw;
-    int delay = 0;
-    Bool newDelay = FALSE;
+    double t = resample_progress(priv, millis);
 
-    while (SynapticsGetHwState(pInfo, priv, &hw)) {
-	hw.millis = GetTimeInMillis();
-	priv->hwState = hw;
-	delay = HandleState(pInfo, &hw);
-	newDelay = TRUE;
+    /* keep the accumulated positions small, start the clock */
+    if (!priv->resample_active) {
+	priv->resample_next = millis + resample_period(priv);
+	priv->resample_from_x -= priv->resample_posted_x;
+	priv->resample_from_y -= priv->resample_posted_y;
+	priv->resample_to_x -= priv->resample_posted_x;
+	priv->resample_to_y -= priv->resample_posted_y;
+	priv->resample_posted_x = priv->resample_posted_y = 0;
     }
 
-    if (newDelay)
-	priv->timer = TimerSet(priv->timer, 0, delay, timerFunc, pInfo);
+    /* start from the position interpolated so far, so nothing jumps */
+    priv->resample_from_x += (priv->resample_to_x - priv->resample_from_x) * t;
+    priv->resample_from_y += (priv->resample_to_y - priv->resample_from_y) * t;
+    priv->resample_to_x += dx;
+    priv->resample_to_y += dy;
+    priv->resample_millis = millis;
+    priv->resample_active = TRUE;
 }
 
-static int
-HandleMidButtonEmulation(SynapticsPrivate *priv, struct SynapticsHwState *hw, int *delay)
+static void
+resample_post(InputInfoPtr pInfo, double x, double y)
 {
-    SynapticsParameters *para = &priv->synpara;
-    Bool done = FALSE;
-    int timeleft;
-    int mid = 0;
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    int dx = x - priv->resample_posted_x;
+    int dy = y - priv->resample_posted_y;
 
-    while (!done) {
-	switch (priv->mid_emu_state) {
-	case MBE_LEFT_CLICK:
-	case MBE_RIGHT_CLICK:
+    if (dx || dy) {
+	xf86PostMotionEvent(pInfo->dev, 0, 0, 2, dx, dy);
+	priv->resample_posted_x += dx;
+	priv->resample_posted_y += dy;
+    }
+}
+
+/* Post all outstanding motion, e.g. before a button event. */
+static void
+resample_flush(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+
+    if (!priv->resample_active)
+	return;
+
+    resample_post(pInfo, priv->resample_to_x, priv->resample_to_y);
+    priv->resample_from_x = priv->resample_to_x;
+    priv->resample_from_y = priv->resample_to_y;
+    priv->resample_active = FALSE;
+}
+
+/*
+ * Post the motion due at time now, if a tick is due. Returns the delay
+ * until the next tick, or 1000000000 once the pointer has caught up.
+ */
+static int
+resample_tick(InputInfoPtr pInfo, int now)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    double t;
+
+    if (!priv->resample_active)
+	return 1000000000;
+
+    if (priv->cp->para.resample_rate <= 0) {
+	resample_flush(pInfo);
+	return 1000000000;
+    }
+
+    if (TIME_DIFF(now, priv->resample_next) < 0)
+	return TIME_DIFF(priv->resample_next, now);
+
+    t = resample_progress(priv, now);
+    if (t >= 1) {
+	resample_flush(pInfo);
+	return 1000000000;
+    }
+
+    resample_post(pInfo,
+		  priv->resample_from_x + (priv->resample_to_x - priv->resample_from_x) * t,
+		  priv->resample_from_y + (priv->resample_to_y - priv->resample_from_y) * t);
+
+    /* keep the phase of the clock unless we fell behind */
+    priv->resample_next += resample_period(priv);
+    if (TIME_DIFF(priv->resample_next, now) <= 0)
+	priv->resample_next = now + resample_period(priv);
+
+    return TIME_DIFF(priv->resample_next, now);
+}
+
+/*
+ * Point the timer at now + delay unless it already is. A delay of
+ * 1000000000 means nothing is pending and disarms it.
+ */
+static void
+set_timer(InputInfoPtr pInfo, CARD32 now, int delay)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    CARD32 wakeUpTime;
+
+    if (delay >= 1000000000) {
+	if (priv->timer_armed) {
+	    TimerCancel(priv->timer);
+	    priv->timer_armed = FALSE;
+	}
+	return;
+    }
+
+    /*
+     * Workaround for wraparound bug in the TimerSet function. This bug is already
+     * fixed in CVS, but this driver needs to work with XFree86 versions 4.2.x and
+     * 4.3.x too. An absolute time that has passed already would run timerFunc
+     * from within TimerSet, hence at least 1 ms.
+     */
+    wakeUpTime = now + MAX(delay, 1);
+    if (wakeUpTime <= now)
+	wakeUpTime = 0xffffffffL;
+
+    if (priv->timer_armed && wakeUpTime == priv->timer_deadline)
+	return;
+
+    priv->timer = TimerSet(priv->timer, TimerAbsolute, wakeUpTime, timerFunc, pInfo);
+    priv->timer_deadline = wakeUpTime;
+    priv->timer_armed = TRUE;
+    priv->timer_rearms++;
+}
+
+/*
+ * Schedule the timer after new hardware frames were handled: HandleState()
+ * wants to run again in delay ms, the resampler may want to tick earlier.
+ */
+void
+arm_timer(InputInfoPtr pInfo, int millis, int delay)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+
+    priv->state_millis = millis + delay;
+    delay = MIN(delay, resample_tick(pInfo, millis));
+    delay = MIN(delay, kinetic_tick(pInfo, millis));
+    set_timer(pInfo, millis, delay);
+}
+
+CARD32
+timerFunc(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    InputInfoPtr pInfo = arg;
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    int delay;
+    int sigstate;
+    Bool posted = FALSE;
+
+    sigstate = xf86BlockSIGIO();
+
+    /* the timer is spent once it fired */
+    priv->timer_armed = FALSE;
+    priv->timer_wakeups++;
+
+    /* resampler ticks in between must not feed extra frames into the
+     * movement history */
+    if (TIME_DIFF(now, priv->state_millis) >= 0) {
+	delay = idle_tick(pInfo, now, &posted);
+	priv->state_millis = now + delay;
+    } else
+	delay = TIME_DIFF(priv->state_millis, now);
+    if (posted || (priv->resample_active && TIME_DIFF(now, priv->resample_next) >= 0) ||
+	priv->kinetic.active)
+	priv->timer_useful++;
+    delay = MIN(delay, resample_tick(pInfo, now));
+    delay = MIN(delay, kinetic_tick(pInfo, now));
+
+    set_timer(pInfo, now, delay);
+
+    xf86UnblockSIGIO(sigstate);
+
+    return 0;
+}
+
+static int
+clamp(int val, int min, int max)
+{
+    if (val < min)
+	return min;
+    else if (val < max)
+	return val;
+    else
+	return max;
+}
+
+static Bool
+SynapticsGetHwState(InputInfoPtr pInfo, SynapticsPrivate *priv)
+{
+    return priv->proto_ops->ReadHwState(pInfo, priv->proto_ops, &priv->comm);
+}
+
+/*
+ *  called for each full received packet from the touchpad
+ */
+static void
+ReadInput(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    struct SynapticsHwState hw;
+    int delay = 0;
+    int nframes = 0;
+
+    while (SynapticsGetHwState(pInfo, priv)) {
+	/* the stages rewrite coordinates and buttons in their own copy,
+	 * comm.hwState stays the last complete frame for timerFunc() */
+	priv->comm.hwState.millis = GetTimeInMillis();
+	hw = priv->comm.hwState;
+	delay = HandleState(pInfo, &hw);
+	nframes++;
+    }
+
+    if (nframes) {
+	update_report_rate(pInfo, hw.millis, nframes);
+	arm_timer(pInfo, hw.millis, delay);
+    }
+}
+
+static int
+HandleMidButtonEmulation(SynapticsPrivate *priv, struct SynapticsHwState *hw, int *delay)
+{
+    const SynapticsParameters *para = &priv->cp->para;
+    Bool done = FALSE;
+    int timeleft;
+    int mid = 0;
+
+    while (!done) {
+	switch (priv->mid_emu_state) {
+	case MBE_LEFT_CLICK:
+	case MBE_RIGHT_CLICK:
 	case MBE_OFF:
 	    priv->button_delay_millis = hw->millis;
 	    if (hw->left) {
@@ -1380,7 +2009,7 @@ HandleMidButtonEmulation(SynapticsPrivate *priv, struct SynapticsHwState *hw, in
 static enum FingerState
 SynapticsDetectFinger(SynapticsPrivate *priv, struct SynapticsHwState *hw)
 {
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     enum FingerState finger;
 
     /* finger detection thru pressure and threshold */
@@ -1435,7 +2064,7 @@ SelectTapButton(SynapticsPrivate *priv, edge_type edge)
 {
     TapEvent tap;
 
-    if (priv->synpara.touchpad_off == 2) {
+    if (priv->cp->para.touchpad_off == 2) {
 	priv->tap_button = 0;
 	return;
     }
@@ -1476,84 +2105,106 @@ SelectTapButton(SynapticsPrivate *priv, edge_type edge)
 	break;
     }
 
-    priv->tap_button = priv->synpara.tap_action[tap];
+    priv->tap_button = priv->cp->para.tap_action[tap];
     priv->tap_button = clamp(priv->tap_button, 0, SYN_MAX_BUTTONS);
 }
 
+/* the side effects of entering a state, tap_step() has set the tap button */
 static void
-SetTapState(SynapticsPrivate *priv, enum TapState tap_state, int millis)
+SetTapState(SynapticsPrivate *priv, enum TapState from, enum TapState tap_state, int millis)
 {
-    SynapticsParameters *para = &priv->synpara;
-    DBG(7, "SetTapState - %d -> %d (millis:%d)\n", priv->tap_state, tap_state, millis);
+    DBG(7, "SetTapState - %d -> %d (millis:%d)\n", from, tap_state, millis);
     switch (tap_state) {
     case TS_START:
-	priv->tap_button_state = TBS_BUTTON_UP;
 	priv->tap_max_fingers = 0;
 	break;
-    case TS_1:
-	priv->tap_button_state = TBS_BUTTON_UP;
-	break;
-    case TS_2A:
-	if (para->fast_taps)
-	    priv->tap_button_state = TBS_BUTTON_DOWN;
-	else
-	    priv->tap_button_state = TBS_BUTTON_UP;
-	break;
-    case TS_2B:
-	priv->tap_button_state = TBS_BUTTON_UP;
-	break;
-    case TS_3:
-	if (para->tap_and_drag_gesture)
-	    priv->tap_button_state = TBS_BUTTON_DOWN;
-	else
-	    priv->tap_button_state = TBS_BUTTON_UP;
-	break;
     case TS_SINGLETAP:
-	if (para->fast_taps)
-	    priv->tap_button_state = TBS_BUTTON_UP;
-	else
-	    priv->tap_button_state = TBS_BUTTON_DOWN;
 	priv->touch_on.millis = millis;
 	break;
     default:
 	break;
     }
-    priv->tap_state = tap_state;
 }
 
 static void
 SetMovingState(SynapticsPrivate *priv, enum MovingState moving_state, int millis)
 {
     DBG(7, "SetMovingState - %d -> %d center at %d/%d (millis:%d)\n", priv->moving_state,
-		  moving_state,priv->hwState.x, priv->hwState.y, millis);
+		  moving_state,priv->comm.hwState.x, priv->comm.hwState.y, millis);
 
     if (moving_state == MS_TRACKSTICK) {
-	priv->trackstick_neutral_x = priv->hwState.x;
-	priv->trackstick_neutral_y = priv->hwState.y;
+	priv->trackstick_neutral_x = priv->comm.hwState.x;
+	priv->trackstick_neutral_y = priv->comm.hwState.y;
     }
     priv->moving_state = moving_state;
 }
 
+/* the parameter holding each state's deadline, -1 for none */
+static const int tap_timeout[TAP_STATES] = {
+    [TS_START] = -1,
+    [TS_1] = offsetof(SynapticsParameters, tap_time),
+    [TS_MOVE] = -1,
+    [TS_2A] = offsetof(SynapticsParameters, single_tap_timeout),
+    [TS_2B] = offsetof(SynapticsParameters, tap_time_2),
+    [TS_SINGLETAP] = offsetof(SynapticsParameters, click_time),
+    [TS_3] = offsetof(SynapticsParameters, tap_time),
+    [TS_DRAG] = -1,
+    [TS_4] = offsetof(SynapticsParameters, locked_drag_time),
+    [TS_5] = offsetof(SynapticsParameters, tap_time),
+};
+
 static int
 GetTimeOut(SynapticsPrivate *priv)
 {
-    SynapticsParameters *para = &priv->synpara;
+    int offset = tap_timeout[priv->tap_state];
 
-    switch (priv->tap_state) {
-    case TS_1:
-    case TS_3:
-    case TS_5:
-	return para->tap_time;
-    case TS_SINGLETAP:
-	return para->click_time;
-    case TS_2A:
-	return para->single_tap_timeout;
-    case TS_2B:
-	return para->tap_time_2;
-    case TS_4:
-	return para->locked_drag_time;
-    default:
+    if (offset < 0)
 	return -1;			    /* No timeout */
+    return *(int *)((char *)&priv->cp->para + offset);
+}
+
+struct TapFrame {
+    SynapticsPrivate *priv;
+    enum FingerState finger;
+    Bool inside_active_area;
+    int millis;
+};
+
+static void
+DoTapAction(void *data, enum TapState from, const struct TapTransition *t)
+{
+    struct TapFrame *f = data;
+    SynapticsPrivate *priv = f->priv;
+    enum FingerState finger = f->finger;
+    int millis = f->millis;
+
+    if (t->next != from)
+	SetTapState(priv, from, t->next, millis);
+    switch (t->action) {
+    case TA_MOVE:
+	SetMovingState(priv, MS_TOUCHPAD_RELATIVE, millis);
+	break;
+    case TA_UNTRACK:
+	if (priv->moving_state == MS_TRACKSTICK)
+	    SetMovingState(priv, MS_TOUCHPAD_RELATIVE, millis);
+	break;
+    case TA_MOVE_FINGER:
+	if (finger == FS_TOUCHED)
+	    SetMovingState(priv, MS_TOUCHPAD_RELATIVE, millis);
+	else if (finger == FS_PRESSED)
+	    SetMovingState(priv, MS_TRACKSTICK, millis);
+	break;
+    case TA_STOP:
+	SetMovingState(priv, MS_FALSE, millis);
+	break;
+    case TA_SELECT:
+	SelectTapButton(priv, edge_detection(priv, priv->touch_on.x, priv->touch_on.y));
+	/* Disable taps outside of the active area */
+	if (!f->inside_active_area)
+	    priv->tap_button = 0;
+	break;
+    default:
+	break;
     }
 }
 
@@ -1561,10 +2212,11 @@ static int
 HandleTapProcessing(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 		    enum FingerState finger, Bool inside_active_area)
 {
-    SynapticsParameters *para = &priv->synpara;
-    Bool touch, release, is_timeout, move;
+    const SynapticsParameters *para = &priv->cp->para;
+    struct TapFrame frame = { priv, finger, inside_active_area, hw->millis };
+    Bool touch, release, move;
     int timeleft, timeout;
-    edge_type edge;
+    int events, conds;
     int delay = 1000000000;
 
     if (priv->palm)
@@ -1589,121 +2241,14 @@ HandleTapProcessing(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 	    priv->tap_max_fingers = hw->numFingers;
     timeout = GetTimeOut(priv);
     timeleft = TIME_DIFF(priv->touch_on.millis + timeout, hw->millis);
-    is_timeout = timeleft <= 0;
 
- restart:
-    switch (priv->tap_state) {
-    case TS_START:
-	if (touch)
-	    SetTapState(priv, TS_1, hw->millis);
-	break;
-    case TS_1:
-	if (move) {
-	    SetMovingState(priv, MS_TOUCHPAD_RELATIVE, hw->millis);
-	    SetTapState(priv, TS_MOVE, hw->millis);
-	    goto restart;
-	} else if (is_timeout) {
-	    if (finger == FS_TOUCHED) {
-		SetMovingState(priv, MS_TOUCHPAD_RELATIVE, hw->millis);
-	    } else if (finger == FS_PRESSED) {
-		SetMovingState(priv, MS_TRACKSTICK, hw->millis);
-	    }
-	    SetTapState(priv, TS_MOVE, hw->millis);
-	    goto restart;
-	} else if (release) {
-	    edge = edge_detection(priv, priv->touch_on.x, priv->touch_on.y);
-	    SelectTapButton(priv, edge);
-	    /* Disable taps outside of the active area */
-	    if (!inside_active_area) {
-		priv->tap_button = 0;
-	    }
-	    SetTapState(priv, TS_2A, hw->millis);
-	}
-	break;
-    case TS_MOVE:
-	if (move && priv->moving_state == MS_TRACKSTICK) {
-	    SetMovingState(priv, MS_TOUCHPAD_RELATIVE, hw->millis);
-	}
-	if (release) {
-	    SetMovingState(priv, MS_FALSE, hw->millis);
-	    SetTapState(priv, TS_START, hw->millis);
-	}
-	break;
-    case TS_2A:
-	if (touch)
-	    SetTapState(priv, TS_3, hw->millis);
-	else if (is_timeout)
-	    SetTapState(priv, TS_SINGLETAP, hw->millis);
-	break;
-    case TS_2B:
-	if (touch) {
-	    SetTapState(priv, TS_3, hw->millis);
-	} else if (is_timeout) {
-	    SetTapState(priv, TS_START, hw->millis);
-	    priv->tap_button_state = TBS_BUTTON_DOWN_UP;
-	}
-	break;
-    case TS_SINGLETAP:
-	if (touch)
-	    SetTapState(priv, TS_1, hw->millis);
-	else if (is_timeout)
-	    SetTapState(priv, TS_START, hw->millis);
-	break;
-    case TS_3:
-	if (move) {
-	    if (para->tap_and_drag_gesture) {
-		SetMovingState(priv, MS_TOUCHPAD_RELATIVE, hw->millis);
-		SetTapState(priv, TS_DRAG, hw->millis);
-	    } else {
-		SetTapState(priv, TS_1, hw->millis);
-	    }
-	    goto restart;
-	} else if (is_timeout) {
-	    if (para->tap_and_drag_gesture) {
-		if (finger == FS_TOUCHED) {
-		    SetMovingState(priv, MS_TOUCHPAD_RELATIVE, hw->millis);
-		} else if (finger == FS_PRESSED) {
-		    SetMovingState(priv, MS_TRACKSTICK, hw->millis);
-		}
-		SetTapState(priv, TS_DRAG, hw->millis);
-	    } else {
-		SetTapState(priv, TS_1, hw->millis);
-	    }
-	    goto restart;
-	} else if (release) {
-	    SetTapState(priv, TS_2B, hw->millis);
-	}
-	break;
-    case TS_DRAG:
-	if (move)
-	    SetMovingState(priv, MS_TOUCHPAD_RELATIVE, hw->millis);
-	if (release) {
-	    SetMovingState(priv, MS_FALSE, hw->millis);
-	    if (para->locked_drags) {
-		SetTapState(priv, TS_4, hw->millis);
-	    } else {
-		SetTapState(priv, TS_START, hw->millis);
-	    }
-	}
-	break;
-    case TS_4:
-	if (is_timeout) {
-	    SetTapState(priv, TS_START, hw->millis);
-	    goto restart;
-	}
-	if (touch)
-	    SetTapState(priv, TS_5, hw->millis);
-	break;
-    case TS_5:
-	if (is_timeout || move) {
-	    SetTapState(priv, TS_DRAG, hw->millis);
-	    goto restart;
-	} else if (release) {
-	    SetMovingState(priv, MS_FALSE, hw->millis);
-	    SetTapState(priv, TS_START, hw->millis);
-	}
-	break;
-    }
+    events = (touch ? TI_TOUCH : 0) | (release ? TI_RELEASE : 0) |
+	     (move ? TI_MOVE : 0) | (timeleft <= 0 ? TI_TIMEOUT : 0);
+    conds = (para->tap_and_drag_gesture ? TC_TAP_AND_DRAG : 0) |
+	    (para->locked_drags ? TC_LOCKED_DRAGS : 0) |
+	    (para->fast_taps ? TC_FAST_TAPS : 0);
+    tap_step(&priv->tap_state, &priv->tap_button_state, events, conds,
+	     DoTapAction, &frame);
 
     timeout = GetTimeOut(priv);
     if (timeout >= 0) {
@@ -1757,11 +2302,157 @@ static int hysteresis(int in, int center, int margin) {
     return center + diff;
 }
 
+/*
+ * Pointer prediction. The pointer is kept ahead of the finger by
+ * pred_x/pred_y, extrapolated from the per-frame velocity and acceleration
+ * over the lag of estimate_delta() plus the configured horizon. Only the
+ * change of that offset is added to the motion, so the lead is paid back
+ * as soon as the finger slows down. A lead dropped at once, when the finger
+ * stops, turns around or lifts, is given back over PREDICT_RETURN_FRAMES
+ * frames instead of as one backward jump.
+ */
+#define PREDICT_FILTER_LAG 1.5		/* frames estimate_delta() lags behind */
+#define PREDICT_MAX_LEAD 8.0		/* frames */
+#define PREDICT_STOP_DELTA 0.5		/* finger delta per frame considered stopped */
+#define PREDICT_RETURN_FRAMES 4
+
+static double
+predict_axis(double delta, double *prev, double *offset, double *owed,
+	     double lead, double damping)
+{
+    double old = *offset;
+    double accel = delta - *prev;
+    double target;
+
+    *prev = delta;
+
+    /* finger stopped or turned around: drop the lead, which puts the
+     * pointer back on the finger without swinging past it */
+    if (fabs(delta) < PREDICT_STOP_DELTA || old * delta < 0) {
+	*offset = 0;
+	*owed += old;
+	return delta;
+    }
+
+    /* never predict against the motion, nor more than twice the linear
+     * extrapolation */
+    target = delta * lead + 0.5 * accel * lead * lead;
+    if (target * delta < 0)
+	target = 0;
+    else if (fabs(target) > fabs(2 * delta * lead))
+	target = 2 * delta * lead;
+
+    *offset = damping * old + (1 - damping) * target;
+    return delta + *offset - old;
+}
+
+/*
+ * Compare the position shown at the time of the last pending prediction
+ * with where the finger actually was by then.
+ */
+static void
+predict_check(SynapticsPrivate *priv, const struct SynapticsHwState *hw)
+{
+    int dt = TIME_DIFF(hw->millis, HIST(0).millis);
+    double x, y, t;
+
+    if (!priv->pred_target_millis ||
+	TIME_DIFF(hw->millis, priv->pred_target_millis) < 0)
+	return;
+
+    t = dt > 0 ? (double)TIME_DIFF(priv->pred_target_millis, HIST(0).millis) / dt : 1;
+    t = MAX(0, MIN(t, 1));
+    x = HIST(0).x + (hw->x - HIST(0).x) * t;
+    y = HIST(0).y + (hw->y - HIST(0).y) * t;
+
+    priv->pred_err += SQR(priv->pred_target_x - x) + SQR(priv->pred_target_y - y);
+    priv->pred_base_err += SQR(priv->pred_base_x - x) + SQR(priv->pred_base_y - y);
+    priv->pred_err_count++;
+    priv->pred_target_millis = 0;
+}
+
+/* give back the next share of a dropped lead, in whole device units as
+ * the motion is posted; what is left under one unit at the end is dropped */
+static void
+predict_return(SynapticsPrivate *priv, double *dx, double *dy)
+{
+    int share_x, share_y;
+
+    if (!priv->pred_return_frames)
+	return;
+
+    share_x = priv->pred_owed_x / priv->pred_return_frames;
+    share_y = priv->pred_owed_y / priv->pred_return_frames;
+    priv->pred_owed_x -= share_x;
+    priv->pred_owed_y -= share_y;
+    if (!--priv->pred_return_frames)
+	priv->pred_owed_x = priv->pred_owed_y = 0;
+    *dx -= share_x;
+    *dy -= share_y;
+}
+
+static void
+predict_delta(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
+              double *dx, double *dy)
+{
+    const SynapticsParameters *para = &priv->cp->para;
+    double lead = PREDICT_FILTER_LAG + para->predict_horizon / priv->frame_time;
+    double lag_x = *dx * PREDICT_FILTER_LAG;
+    double lag_y = *dy * PREDICT_FILTER_LAG;
+    double owed_x, owed_y;
+
+    lead = MIN(lead, PREDICT_MAX_LEAD);
+    predict_check(priv, hw);
+
+    owed_x = priv->pred_owed_x;
+    owed_y = priv->pred_owed_y;
+    *dx = predict_axis(*dx, &priv->pred_dx, &priv->pred_x, &priv->pred_owed_x,
+		       lead, para->predict_damping);
+    *dy = predict_axis(*dy, &priv->pred_dy, &priv->pred_y, &priv->pred_owed_y,
+		       lead, para->predict_damping);
+    if (priv->pred_owed_x != owed_x || priv->pred_owed_y != owed_y)
+	priv->pred_return_frames = PREDICT_RETURN_FRAMES;
+    predict_return(priv, dx, dy);
+
+    if (!priv->pred_target_millis) {
+	priv->pred_base_x = hw->x - lag_x;
+	priv->pred_base_y = hw->y - lag_y;
+	priv->pred_target_x = priv->pred_base_x + priv->pred_x;
+	priv->pred_target_y = priv->pred_base_y + priv->pred_y;
+	priv->pred_target_millis = hw->millis + MAX(1, (int)para->predict_horizon);
+    }
+}
+
+/*
+ * Movement ended: start giving the outstanding lead back through dx/dy,
+ * and go on with it on every call until it is paid off. Logs how well the
+ * prediction did so far.
+ */
+static void
+predict_reset(SynapticsPrivate *priv, double *dx, double *dy)
+{
+    if (priv->pred_x || priv->pred_y) {
+	priv->pred_owed_x += priv->pred_x;
+	priv->pred_owed_y += priv->pred_y;
+	priv->pred_return_frames = PREDICT_RETURN_FRAMES;
+	priv->pred_x = priv->pred_y = 0;
+
+	if (priv->pred_err_count)
+	    DBG(7, "prediction error %.1f, without prediction %.1f (rms of %d)\n",
+		sqrt(priv->pred_err / priv->pred_err_count),
+		sqrt(priv->pred_base_err / priv->pred_err_count),
+		priv->pred_err_count);
+    }
+    priv->pred_dx = priv->pred_dy = 0;
+    priv->pred_target_millis = 0;
+    predict_return(priv, dx, dy);
+}
+
 static void
 get_delta_for_trackstick(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
                          double *dx, double *dy)
 {
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     double dtime = (hw->millis - HIST(0).millis) / 1000.0;
 
     *dx = (hw->x - priv->trackstick_neutral_x);
@@ -1775,7 +2466,7 @@ static void
 get_edge_speed(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
                edge_type edge, int *x_edge_speed, int *y_edge_speed)
 {
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
 
     int minZ = para->edge_motion_min_z;
     int maxZ = para->edge_motion_max_z;
@@ -1790,7 +2481,7 @@ get_edge_speed(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
     } else {
         edge_speed = minSpd + (hw->z - minZ) * (maxSpd - minSpd) / (maxZ - minZ);
     }
-    if (!priv->synpara.circular_pad) {
+    if (!priv->cp->para.circular_pad) {
         /* on rectangular pad */
         if (edge & RIGHT_EDGE) {
             *x_edge_speed = edge_speed;
@@ -1806,7 +2497,7 @@ get_edge_speed(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
         /* at edge of circular pad */
         double relX, relY;
 
-        relative_coords(priv, hw->x, hw->y, &relX, &relY);
+        zone_relative(&priv->cp->zones, hw->x, hw->y, &relX, &relY);
         *x_edge_speed = (int)(edge_speed * relX);
         *y_edge_speed = (int)(edge_speed * relY);
     }
@@ -1816,7 +2507,7 @@ static void
 get_delta(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
           edge_type edge, double *dx, double *dy)
 {
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     double dtime = (hw->millis - HIST(0).millis) / 1000.0;
     double integral;
     double tmpf;
@@ -1827,6 +2518,9 @@ get_delta(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
     *dx = estimate_delta(hw->x, HIST(0).x, HIST(1).x, HIST(2).x);
     *dy = estimate_delta(hw->y, HIST(0).y, HIST(1).y, HIST(2).y);
 
+    if (para->predict_horizon > 0)
+        predict_delta(priv, hw, dx, dy);
+
     if ((priv->tap_state == TS_DRAG) || para->edge_motion_use_always)
         get_edge_speed(priv, hw, edge, &x_edge_speed, &y_edge_speed);
 
@@ -1840,6 +2534,30 @@ get_delta(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
     *dy = integral;
 }
 
+/*
+ * When the pointer has to move on without new input once the finger is at
+ * x/y, in ms. Edge motion, the trackstick mode and giving back a predicted
+ * lead move it every frame. A
+ * motion estimate that lags behind a finger that stopped is drained only
+ * once the next report is overdue, a device that goes on reporting never
+ * needs the timer for it.
+ */
+static int
+motion_delay(SynapticsPrivate *priv, int x, int y, edge_type edge)
+{
+    const SynapticsParameters *para = &priv->cp->para;
+
+    if (priv->moving_state == MS_TRACKSTICK || priv->pred_return_frames)
+	return frame_delay(priv);
+    if (edge != NO_EDGE && (priv->tap_state == TS_DRAG || para->edge_motion_use_always) &&
+	(para->edge_motion_min_speed || para->edge_motion_max_speed))
+	return frame_delay(priv);
+    if (x != HIST(0).x || HIST(0).x != HIST(1).x || HIST(1).x != HIST(2).x ||
+	y != HIST(0).y || HIST(0).y != HIST(1).y || HIST(1).y != HIST(2).y)
+	return 2 * frame_delay(priv);
+    return 1000000000;
+}
+
 /**
  * Compute relative motion ('deltas') including edge motion xor trackstick.
  */
@@ -1882,12 +2600,15 @@ ComputeDeltas(SynapticsPrivate *priv, const struct SynapticsHwState *hw,
 	)
     {
         priv->count_packet_finger = 0;
+        predict_reset(priv, &dx, &dy);
+        if (priv->pred_return_frames)
+            delay = frame_delay(priv);
         goto out;
     }
 
     /* to create fluid edge motion, call back 'soon'
      * even in the absence of new hardware events */
-    delay = MIN(delay, 13);
+    delay = MIN(delay, motion_delay(priv, hw->x, hw->y, edge));
 
     if (priv->count_packet_finger <= 3) /* min. 3 packets, see get_delta() */
         goto skip; /* skip the lot */
@@ -1928,6 +2649,7 @@ out:
 
 struct ScrollData {
     int left, right, up, down;
+    double delta_x, delta_y;		/* smooth scroll, device units */
     //Scrolling
 };
 
@@ -1936,25 +2658,32 @@ static inline void
 finger_scroll_on_start(SynapticsPrivate *priv,
 		struct SynapticsHwState *hw, SynapticsMetric axis)
 {
+	double pos = (axis == SYNMETRIC_X) ? hw->x : hw->y;
+
 	priv->count_scroll_finger = 0;
-	int i;
+	if(hw->contacts.count >= 2)
+		pos = hw->contacts.centroid[axis];
 
 	if(axis == SYNMETRIC_X) {
 	    DBG(7, "horiz two-finger scroll detected\n");
 	    priv->scroll_last_delta_x = POS_OOB;
-		priv->scroll_x = hw->x;
+		priv->scroll_x = pos;
+		priv->scroll_smooth_pos[axis] = pos;
 		priv->horiz_scroll_twofinger_on = TRUE;
 		priv->horiz_scroll_edge_on = FALSE;
 	} else {
 	    DBG(7, "vert two-finger scroll detected\n");
 //	    priv->scroll_last_delta_y = POS_OOB;
-		priv->scroll_y = hw->y;
+		priv->scroll_y = pos;
+		priv->scroll_smooth_pos[axis] = pos;
 		priv->vert_scroll_twofinger_on = TRUE;
 		priv->vert_scroll_edge_on = FALSE;
 	}
-	for(i = 0; i < 3; i++) {
-		synhist_reset( &(priv->scroll_hist[axis][i]) );
-	}
+	synhist_reset( &(priv->scroll_hist[axis]) );
+	priv->scroll_onset[axis] = FALSE;
+	priv->scroll_onset_start[axis] = pos;
+	priv->scroll_onset_spread[axis] = hw->contacts.spread[axis];
+	priv->scroll_start_millis[axis] = hw->millis;
 }
 
 static inline void
@@ -1968,83 +2697,91 @@ finger_scroll_on_end(SynapticsPrivate *priv, SynapticsMetric axis)
 	}
 }
 
+/*
+ * The fingers are taken to scroll as soon as their centroid has moved by
+ * more than the noise threshold while their spread along the axis stayed
+ * put (a pinch barely moves the centroid, a single finger moving past a
+ * resting thumb changes the spread as much as the centroid). Fingers that
+ * never move coherently still start scrolling after SCROLL_ONSET_FALLBACK
+ * samples, as before.
+ */
+#define SCROLL_ONSET_NOISE_DIV 4	/* noise threshold, fraction of the scroll distance */
+#define SCROLL_ONSET_COHERENCE 0.5	/* max spread change per centroid movement */
+#define SCROLL_ONSET_FALLBACK 10	/* samples until the centroid alone may scroll */
+
+static Bool
+scroll_onset_coherent(SynapticsPrivate *priv, const SynapticsContacts *c,
+		      SynapticsMetric m, int para_delta)
+{
+	int noise = MAX(abs(para_delta) / SCROLL_ONSET_NOISE_DIV, 1);
+	double d, ds;
+
+	if (priv->scroll_hist[m].count == 0)
+		return FALSE;
+
+	d = fabs(c->centroid[m] - priv->scroll_onset_start[m]);
+	ds = fabs(c->spread[m] - priv->scroll_onset_spread[m]);
+	if (d < noise)
+		return FALSE;
+
+	return ds <= SCROLL_ONSET_COHERENCE * d;
+}
+
 static inline void
 finger_scroll_update(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 		struct ScrollData *sd, SynapticsMetric m)
 {
-	int current[2], pos_avg = POS_OOB, i, last;
+	const SynapticsContacts *c = &hw->contacts;
+	SynhistLog *log = &(priv->scroll_hist[m]);
+	int pos_avg;
 	int *scrollp;
 
 	 /*What sd fields to update, if the current position is greater or smaller*/
 	int *gt_p, *lt_p;
+	double *smooth_p;
 
 	int para_delta;
-	SynapticsFinger **fingers = hw->scroll_fingers;
-	Bool *fsel = hw->scroll_pass[m];
-	SynhistLog *log = priv->scroll_hist[m];
-	if(fingers[0] == NULL || fingers[1] == NULL) {
-		return;
-	}
-	yolog_info("%p, %p", fingers[0], fingers[1]);
-	if(fsel[0] == FALSE && fsel[1] == FALSE) {
-		yolog_debug("Didn't get anything useful. Returning");
+
+	if(c->count < 2 || !c->moved) {
 		return;
 	}
 
 	/*TODO: We should refactor these _x and _y stuff*/
 	if(m == SYNMETRIC_X) {
 		scrollp = &(priv->scroll_x);
-		para_delta = priv->synpara.scroll_dist_horiz;
+		para_delta = priv->cp->para.scroll_dist_horiz;
 		gt_p = &(sd->right);
 		lt_p = &(sd->left);
+		smooth_p = &(sd->delta_x);
 	} else {
 		scrollp = &(priv->scroll_y);
-		para_delta = priv->synpara.scroll_dist_vert;
+		para_delta = priv->cp->para.scroll_dist_vert;
 		/*Y coords are reversed*/
 		gt_p = &(sd->down);
 		lt_p = &(sd->up);
+		smooth_p = &(sd->delta_y);
 	}
 
-	/*Collect the values*/
-	for (i = 0; i < 2; i++) {
-		if(fsel[i]) {
-			current[i] = fingers[i]->metric[m];
-			last = i;
-		} else {
-			current[i] = POS_OOB;
-		}
-	}
+	pos_avg = c->centroid[m];
 
-	/*We have a partial update*/
-	if(current[0] == POS_OOB || current[1] == POS_OOB) {
-		yolog_warn("Got partial update");
-		int last_other = (last == 0) ? 1 : 0;
-		int last_vals[1];
-		int *tmp = last_vals;
-		synhist_last_values(&(log[last_other]), 1, &tmp);
-		if(tmp) {
-			/*We have history data for the partial update. Collect*/
-			pos_avg = (last_vals[0] + fingers[last]->metric[m]) / 2;
-			yolog_info("Got history log: %d. Compare with %d", last_vals[0],
-					fingers[last]->metric[m]);
-		} else {
-			/*No previous history*/
-			pos_avg = *scrollp;
-		}
-	} else {
-		pos_avg = (current[0] + current[1]) / 2;
+	if(!priv->scroll_onset[m] && scroll_onset_coherent(priv, c, m, para_delta)) {
+		/* scroll by everything the fingers moved since they landed */
+		*scrollp = priv->scroll_onset_start[m];
+		priv->scroll_smooth_pos[m] = *scrollp;
+		priv->scroll_onset[m] = TRUE;
+		DBG(7, "%d-finger scroll onset after %d samples\n",
+		    c->count, log->count);
 	}
 
-	GT_UPDATE:
-
-	if(log[SYNHIST_IDX_AVG].count >= 10)
+	if(priv->scroll_onset[m] || log->count >= SCROLL_ONSET_FALLBACK)
 	{
-		if(log[SYNHIST_IDX_AVG].count < 30) {
-			para_delta += (30 - log[SYNHIST_IDX_AVG].count);
+		if(!priv->scroll_onset[m] && log->count < 30) {
+			para_delta += (30 - log->count);
 		}
-		yolog_warn("pos_avg=%d", pos_avg);
 		int n_gt = 0, n_lt = 0;
-		int diff = abs(pos_avg - *scrollp);
+
+		*smooth_p += pos_avg - priv->scroll_smooth_pos[m];
+		priv->scroll_smooth_pos[m] = pos_avg;
 
 		while(pos_avg - *scrollp > para_delta) {
 			n_gt++;
@@ -2060,102 +2797,102 @@ finger_scroll_update(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 			*gt_p += n_gt;
 		}
 
-	}
-	GT_LOG:
-	last = -1;
-	for(i = 0; i < 2; i++) {
-		if(fingers[i] && fsel[i]) {
-			synhist_set(&(log[i]), fingers[i]->metric[m], hw->millis);
+		if(priv->scroll_start_millis[m] && (n_lt || n_gt || *smooth_p != 0)) {
+			DBG(7, "first scroll %d ms after touch\n",
+			    TIME_DIFF(hw->millis, priv->scroll_start_millis[m]));
+			priv->scroll_start_millis[m] = 0;
 		}
 	}
-	/*Update averages count*/
-	if(pos_avg == POS_OOB) {
-		return;
-	}
-	synhist_set(&(log[SYNHIST_IDX_AVG]), pos_avg, hw->millis);
+	synhist_set(log, pos_avg, hw->millis);
+}
+
+#define COASTING_BACKLOG 4		/* history entries to take the speed from */
+#define COASTING_STOP_SPEED 1.0		/* scrolls/s at which coasting ends */
+
+/*
+ * Velocity of a scroll axis in scrolls per second from its two-finger
+ * history. residual is what has moved since the last whole scroll step.
+ */
+static Bool
+coasting_speed(SynapticsPrivate *priv, SynapticsMetric m, int dist, int scroll_pos,
+	       double *speed, double *residual)
+{
+    SynhistLog *log = &(priv->scroll_hist[m]);
+    int last_pos[1];
+    int *tmp = last_pos;
+    double v;
+
+    if (dist == 0 || !kinetic_estimate(log, COASTING_BACKLOG, &v))
+	return FALSE;
+
+    synhist_last_values(log, 1, &tmp);
+    *speed = v / dist;
+    *residual = (last_pos[0] - scroll_pos) / (double)dist;
+    return TRUE;
 }
 
 static void
 start_coasting(SynapticsPrivate *priv, struct SynapticsHwState *hw, edge_type edge,
 	       Bool vertical)
 {
-    SynapticsParameters *para = &priv->synpara;
-    SynapticsMetric m = SYNMETRIC_Y;
-    SynhistLog *log = &(priv->scroll_hist[m][SYNHIST_IDX_AVG]);
+    const SynapticsParameters *para = &priv->cp->para;
+    double xspd = 0, yspd = 0;
+
     priv->autoscroll_y = 0.0;
     priv->autoscroll_x = 0.0;
-    int hist_count = log->count;
-    int last_pos[4], last_times[4];
-    int *tmp;
-
-    if (hist_count > 3 && (para->coasting_speed > 0.0)) {
-    	yolog_debug("Trying to estimate coasting");
-        tmp = last_times;
-        synhist_last_times(log, 4, &tmp);
-        if(!tmp) {
-        	yolog_err("OOPS!");
-        	return;
-        }
-        tmp = last_pos;
-        synhist_last_values(log, 4, &tmp);
-        if(!tmp) {
-        	yolog_err("OOPS2");
-        	return;
-        }
-        double pkt_time = (last_times[0] - last_times[3]) / 1000.0;
-	    double dy = estimate_delta(last_pos[0], last_pos[1], last_pos[2], last_pos[3]);
-	    yolog_info("times: %d,%d,%d,%d", last_times[0], last_times[1],last_times[2],last_times[3]);
-	    yolog_info("pos: %d,%d,%d,%d", last_pos[0], last_pos[1], last_pos[2], last_pos[3]);
-	    yolog_info("pkt_time=%0.5f, dy=%0.5f", pkt_time, dy);
-	    int sdelta = para->scroll_dist_vert;
-	    if ((para->scroll_twofinger_vert || (edge & RIGHT_EDGE)) && pkt_time > 0 && sdelta > 0) {
-	    	double scrolls_per_sec = dy / pkt_time / sdelta;
-	    	if (fabs(scrolls_per_sec) >= para->coasting_speed) {
-	    		priv->autoscroll_yspd = scrolls_per_sec;
-	    		priv->autoscroll_y = (last_pos[0] - priv->scroll_y) / (double)sdelta;
-	    	}
-	    }
-//	if (para->scroll_twofinger_horiz || !vertical){
-//	    double dx = estimate_delta(HIST(0).x, HIST(1).x, HIST(2).x, HIST(3).x);
-//	    int sdelta = para->scroll_dist_horiz;
-//	    if ((para->scroll_twofinger_horiz || (edge & BOTTOM_EDGE)) && pkt_time > 0 && sdelta > 0) {
-//		double scrolls_per_sec = dx / pkt_time / sdelta;
-//		if (fabs(scrolls_per_sec) >= para->coasting_speed) {
-//		    priv->autoscroll_xspd = scrolls_per_sec;
-//		    priv->autoscroll_x = (hw->x - priv->scroll_x) / (double)sdelta;
-//		}
-//	    }
-//	}
-    }
     priv->scroll_packet_count = 0;
+
+    if (para->coasting_speed <= 0.0)
+	return;
+
+    if (para->scroll_twofinger_vert || (edge & RIGHT_EDGE))
+	coasting_speed(priv, SYNMETRIC_Y, para->scroll_dist_vert, priv->scroll_y,
+		       &yspd, &priv->autoscroll_y);
+    if (para->scroll_twofinger_horiz || (edge & BOTTOM_EDGE))
+	coasting_speed(priv, SYNMETRIC_X, para->scroll_dist_horiz, priv->scroll_x,
+		       &xspd, &priv->autoscroll_x);
+
+    if (SQR(xspd) + SQR(yspd) < priv->cp->coasting_speed_sq)
+	return;
+
+    kinetic_start(&priv->kinetic, xspd, yspd, para->coasting_friction,
+		  priv->cp->coasting_tau, COASTING_STOP_SPEED, hw->millis);
+    DBG(7, "coasting at %.1f,%.1f scrolls/s for %.0f ms\n", xspd, yspd,
+	kinetic_remaining(&priv->kinetic) * 1000);
 }
 
 static void
 stop_coasting(SynapticsPrivate *priv)
 {
-    priv->autoscroll_xspd = 0;
-    priv->autoscroll_yspd = 0;
+    if (priv->kinetic.active)
+	DBG(7, "coasting stopped, %.0f ms early\n",
+	    kinetic_remaining(&priv->kinetic) * 1000);
+    kinetic_stop(&priv->kinetic);
     priv->scroll_packet_count = 0;
 }
 
+/* end any scrolling, for when the scroll stage is left out */
+static void
+scroll_reset(SynapticsPrivate *priv)
+{
+    stop_coasting(priv);
+    priv->circ_scroll_on = FALSE;
+    priv->vert_scroll_edge_on = FALSE;
+    priv->horiz_scroll_edge_on = FALSE;
+    priv->vert_scroll_twofinger_on = FALSE;
+    priv->horiz_scroll_twofinger_on = FALSE;
+}
+
 static int
 HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 		edge_type edge, Bool finger, struct ScrollData *sd)
 {
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     int delay = 1000000000;
 
     sd->left = sd->right = sd->up = sd->down = 0;
+    sd->delta_x = sd->delta_y = 0;
 
-    if (priv->synpara.touchpad_off == 2) {
-	stop_coasting(priv);
-	priv->circ_scroll_on = FALSE;
-	priv->vert_scroll_edge_on = FALSE;
-	priv->horiz_scroll_edge_on = FALSE;
-	priv->vert_scroll_twofinger_on = FALSE;
-	priv->horiz_scroll_twofinger_on = FALSE;
-	return delay;
-    }
     int effective_numFingers = hw->numFingers;
     if(priv->amt_last_action) {
     	effective_numFingers--;
@@ -2175,7 +2912,7 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 		(para->circular_trigger == 8 && edge & LEFT_EDGE && edge & TOP_EDGE)) {
 		priv->circ_scroll_on = TRUE;
 		priv->circ_scroll_vert = TRUE;
-		priv->scroll_a = angle(priv, hw->x, hw->y);
+		priv->scroll_a = priv->scroll_smooth_a = angle(priv, hw->x, hw->y);
 		DBG(7, "circular scroll detected on edge\n");
 	    }
 	}
@@ -2244,7 +2981,7 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 	}
 	/* If we were corner edge scrolling (coasting),
 	 * but no longer in corner or raised a finger, then stop coasting. */
-	if (para->scroll_edge_corner && (priv->autoscroll_xspd || priv->autoscroll_yspd)) {
+	if (para->scroll_edge_corner && priv->kinetic.active) {
 	    Bool is_in_corner =
 		((edge & RIGHT_EDGE)  && (edge & (TOP_EDGE | BOTTOM_EDGE))) ||
 		((edge & BOTTOM_EDGE) && (edge & (LEFT_EDGE | RIGHT_EDGE))) ;
@@ -2270,7 +3007,7 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
     if (priv->vert_scroll_edge_on && !priv->horiz_scroll_edge_on &&
 	(edge & RIGHT_EDGE) && (edge & (TOP_EDGE | BOTTOM_EDGE))) {
 	if (para->scroll_edge_corner) {
-	    if (priv->autoscroll_yspd == 0) {
+	    if (!priv->kinetic.active) {
 		/* FYI: We can generate multiple start_coasting requests if
 		 * we're in the corner, but we were moving so slowly when we
 		 * got here that we didn't actually start coasting. */
@@ -2281,7 +3018,7 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 	    priv->vert_scroll_edge_on = FALSE;
 	    priv->circ_scroll_on = TRUE;
 	    priv->circ_scroll_vert = TRUE;
-	    priv->scroll_a = angle(priv, hw->x, hw->y);
+	    priv->scroll_a = priv->scroll_smooth_a = angle(priv, hw->x, hw->y);
 	    DBG(7, "switching to circular scrolling\n");
 	}
     }
@@ -2289,7 +3026,7 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
     if (priv->horiz_scroll_edge_on && !priv->vert_scroll_edge_on &&
 	(edge & BOTTOM_EDGE) && (edge & (LEFT_EDGE | RIGHT_EDGE))) {
 	if (para->scroll_edge_corner) {
-	    if (priv->autoscroll_xspd == 0) {
+	    if (!priv->kinetic.active) {
 		/* FYI: We can generate multiple start_coasting requests if
 		 * we're in the corner, but we were moving so slowly when we
 		 * got here that we didn't actually start coasting. */
@@ -2300,7 +3037,7 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 	    priv->horiz_scroll_edge_on = FALSE;
 	    priv->circ_scroll_on = TRUE;
 	    priv->circ_scroll_vert = FALSE;
-	    priv->scroll_a = angle(priv, hw->x, hw->y);
+	    priv->scroll_a = priv->scroll_smooth_a = angle(priv, hw->x, hw->y);
 	    DBG(7, "switching to circular scrolling\n");
 	}
     }
@@ -2355,88 +3092,58 @@ HandleScrolling(SynapticsPrivate *priv, struct SynapticsHwState *hw,
 	/* + = counter clockwise, - = clockwise */
 	double delta = para->scroll_dist_circ;
 	if (delta >= 0.005) {
-	    while (diffa(priv->scroll_a, angle(priv, hw->x, hw->y)) > delta) {
+	    double a = angle(priv, hw->x, hw->y);
+	    double da = circ_diff(priv->scroll_smooth_a, a) * priv->cp->circ_inv_delta;
+	    int n = circ_steps(&priv->scroll_a, a, delta, priv->cp->circ_inv_delta);
+
+	    priv->scroll_smooth_a = a;
+	    if (priv->circ_scroll_vert)
+		sd->delta_y -= da * para->scroll_dist_vert;
+	    else
+		sd->delta_x += da * para->scroll_dist_horiz;
+
+	    if (n > 0) {
 		if (priv->circ_scroll_vert)
-		    sd->up++;
+		    sd->up += n;
 		else
-		    sd->right++;
-		priv->scroll_a += delta;
-		if (priv->scroll_a > M_PI)
-		    priv->scroll_a -= 2 * M_PI;
-	    }
-	    while (diffa(priv->scroll_a, angle(priv, hw->x, hw->y)) < -delta) {
+		    sd->right += n;
+	    } else if (n < 0) {
 		if (priv->circ_scroll_vert)
-		    sd->down++;
+		    sd->down -= n;
 		else
-		    sd->left++;
-		priv->scroll_a -= delta;
-		if (priv->scroll_a < -M_PI)
-		    priv->scroll_a += 2 * M_PI;
+		    sd->left -= n;
 	    }
 	}
     }
 
-    if (priv->autoscroll_yspd) {
-	double dtime = (hw->millis - HIST(0).millis) / 1000.0;
-	double ddy = para->coasting_friction * dtime;
-	priv->autoscroll_y += priv->autoscroll_yspd * dtime;
-	delay = MIN(delay, 20);
-	while (priv->autoscroll_y > 1.0) {
-	    sd->down++;
-	    priv->autoscroll_y -= 1.0;
-	}
-	while (priv->autoscroll_y < -1.0) {
-	    sd->up++;
-	    priv->autoscroll_y += 1.0;
-	}
-	if (abs(priv->autoscroll_yspd) < ddy) {
-	    priv->autoscroll_yspd = 0;
-	    priv->scroll_packet_count = 0;
-	} else {
-	    priv->autoscroll_yspd += (priv->autoscroll_yspd < 0 ? ddy : -1*ddy);
-	}
-    }
-
-    if (priv->autoscroll_xspd) {
-	double dtime = (hw->millis - HIST(0).millis) / 1000.0;
-	double ddx = para->coasting_friction * dtime;
-	priv->autoscroll_x += priv->autoscroll_xspd * dtime;
-	delay = MIN(delay, 20);
-	while (priv->autoscroll_x > 1.0) {
-	    sd->right++;
-	    priv->autoscroll_x -= 1.0;
-	}
-	while (priv->autoscroll_x < -1.0) {
-	    sd->left++;
-	    priv->autoscroll_x += 1.0;
-	}
-	if (abs(priv->autoscroll_xspd) < ddx) {
-	    priv->autoscroll_xspd = 0;
-	    priv->scroll_packet_count = 0;
-	} else {
-	    priv->autoscroll_xspd += (priv->autoscroll_xspd < 0 ? ddx : -1*ddx);
-	}
-    }
-
     return delay;
 }
 
 static void
-handle_clickfinger(SynapticsParameters *para, struct SynapticsHwState *hw,
+handle_clickfinger(const SynapticsParameters *para, struct SynapticsHwState *hw,
 		SynapticsPrivate *priv)
 {
     int action = 0;
     if(!priv->amt_last_action) {
-        switch(hw->numFingers){
-            case 1:
-                action = para->click_action[F1_CLICK1];
-                break;
-            case 2:
-                action = para->click_action[F2_CLICK1];
-                break;
-            case 3:
-                action = para->click_action[F3_CLICK1];
-                break;
+        /* a click inside a soft button area is that button, whatever
+         * the number of fingers on the pad */
+        if (hw->pressing_finger)
+            action = get_button_zone(priv, hw->pressing_finger->metric[SYNMETRIC_X],
+                                     hw->pressing_finger->metric[SYNMETRIC_Y]);
+        else
+            action = get_button_zone(priv, hw->x, hw->y);
+        if (!action) {
+            switch(hw->numFingers){
+                case 1:
+                    action = para->click_action[F1_CLICK1];
+                    break;
+                case 2:
+                    action = para->click_action[F2_CLICK1];
+                    break;
+                case 3:
+                    action = para->click_action[F3_CLICK1];
+                    break;
+            }
         }
         priv->amt_last_action = action;
     } else {
@@ -2482,7 +3189,7 @@ update_shm(const InputInfoPtr pInfo, const struct SynapticsHwState *hw)
     shm->up = hw->up;
     shm->down = hw->down;
     for (i = 0; i < 8; i++)
-	    shm->multi[i] = hw->multi[i];
+	    shm->multi[i] = HW_MULTI(hw, i);
     shm->middle = hw->middle;
 }
 
@@ -2495,7 +3202,7 @@ static Bool
 adjust_state_from_scrollbuttons(const InputInfoPtr pInfo, struct SynapticsHwState *hw)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     Bool double_click = FALSE;
 
     if (!para->updown_button_scrolling) {
@@ -2515,28 +3222,25 @@ adjust_state_from_scrollbuttons(const InputInfoPtr pInfo, struct SynapticsHwStat
 
     /* Left/right button scrolling, or middle clicks */
     if (!para->leftright_button_scrolling) {
-	if (hw->multi[2] || hw->multi[3])
+	if (HW_MULTI(hw, 2) || HW_MULTI(hw, 3))
 	    hw->middle = TRUE;
 
 	/* reset left/right button events */
-	hw->multi[2] = hw->multi[3] = FALSE;
+	hw->multi &= ~((1 << 2) | (1 << 3));
     }
 
     return double_click;
 }
 
 static void
-update_hw_button_state(const InputInfoPtr pInfo, struct SynapticsHwState *hw, int *delay)
+update_hw_button_state(const InputInfoPtr pInfo, struct SynapticsHwState *hw)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
 
     /* Treat the first two multi buttons as up/down for now. */
-    hw->up |= hw->multi[0];
-    hw->down |= hw->multi[1];
-
-    /* 3rd button emulation */
-    hw->middle |= HandleMidButtonEmulation(priv, hw, delay);
+    hw->up |= HW_MULTI(hw, 0);
+    hw->down |= HW_MULTI(hw, 1);
 
     /* Fingers emulate other buttons */
     if(hw->left && hw->numFingers >= 1){
@@ -2559,10 +3263,90 @@ post_button_click(const InputInfoPtr pInfo, const int button)
     xf86PostButtonEvent(pInfo->dev, FALSE, button, FALSE, 0, 0);
 }
 
+#define GESTURE_SWIPE_FRACTION 0.15	/* swipe distance, fraction of the pad width */
+
+/*
+ * Feed the contact summary to the gesture recognizer and click the button
+ * and press the key configured for whatever it recognised.
+ */
+static void
+handle_gestures(const InputInfoPtr pInfo, struct SynapticsHwState *hw)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    const SynapticsContacts *c = &hw->contacts;
+    double centroid[SYNAPTICS_METRIC_COUNT] = { c->centroid[SYNMETRIC_X], c->centroid[SYNMETRIC_Y] };
+    int ev, button, key;
+
+    ev = gesture_update(&priv->gesture, c->count, centroid,
+			hypot(c->spread[SYNMETRIC_X], c->spread[SYNMETRIC_Y]),
+			c->rotation,
+			(priv->maxx - priv->minx) * GESTURE_SWIPE_FRACTION);
+    if (ev == GESTURE_NONE)
+	return;
+
+    button = priv->cp->para.gesture_action[ev];
+    key = priv->has_gesture_keys ? priv->cp->para.gesture_key[ev] : 0;
+    DBG(7, "gesture %d, button %d, key %d\n", ev, button, key);
+    if (button > 0 || key > 0)
+	resample_flush(pInfo);
+    if (button > 0)
+	post_button_click(pInfo, button);
+    if (key > 0) {
+	xf86PostKeyboardEvent(pInfo->dev, key, TRUE);
+	xf86PostKeyboardEvent(pInfo->dev, key, FALSE);
+    }
+}
+
+/* three or four fingers with a swipe configured don't move the pointer */
+static Bool
+gesture_holds_pointer(SynapticsPrivate *priv, const struct SynapticsHwState *hw)
+{
+    const SynapticsParameters *para = &priv->cp->para;
+    int first, i;
+
+    if (hw->contacts.count == 3)
+	first = SWIPE3_LEFT;
+    else if (hw->contacts.count == 4)
+	first = SWIPE4_LEFT;
+    else
+	return FALSE;
+
+    for (i = first; i < first + 4; i++)
+	if (para->gesture_action[i] || (priv->has_gesture_keys && para->gesture_key[i]))
+	    return TRUE;
+    return FALSE;
+}
+
+
+static void
+post_relative_motion(const InputInfoPtr pInfo, int dx, int dy, int millis)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+
+    if (priv->cp->para.resample_rate > 0)
+	resample_push(priv, dx, dy, millis);
+    else
+	xf86PostMotionEvent(pInfo->dev, 0, 0, 2, dx, dy);
+}
 
 static void
 post_scroll_events(const InputInfoPtr pInfo, struct ScrollData scroll)
 {
+#ifdef HAVE_SMOOTH_SCROLL
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+
+    /* one event for both axes, the server emulates buttons 4-7 from the
+     * scroll valuators for clients that don't know about them */
+    if (scroll.delta_x == 0 && scroll.delta_y == 0)
+	return;
+
+    valuator_mask_zero(priv->scroll_events_mask);
+    if (scroll.delta_x != 0)
+	valuator_mask_set_double(priv->scroll_events_mask, 2, scroll.delta_x);
+    if (scroll.delta_y != 0)
+	valuator_mask_set_double(priv->scroll_events_mask, 3, scroll.delta_y);
+    xf86PostMotionEventM(pInfo->dev, FALSE, priv->scroll_events_mask);
+#else
     while (scroll.up-- > 0) {
     	yolog_debug("Posting up");
         post_button_click(pInfo, 4);
@@ -2578,24 +3362,73 @@ post_scroll_events(const InputInfoPtr pInfo, struct ScrollData scroll)
 
     while (scroll.right-- > 0)
         post_button_click(pInfo, 7);
+#endif
+}
+
+/*
+ * Step the coasting engine and post the scrolling covered since the last
+ * step. Returns the delay until the next step, or 1000000000 once coasting
+ * has ended.
+ */
+static int
+kinetic_tick(InputInfoPtr pInfo, int now)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    const SynapticsParameters *para = &priv->cp->para;
+    struct ScrollData sd = { 0 };
+    double dx, dy;
+    Bool active;
+
+    if (!priv->kinetic.active)
+	return 1000000000;
+
+    active = kinetic_step(&priv->kinetic, now, &dx, &dy);
+    sd.delta_x = dx * para->scroll_dist_horiz;
+    sd.delta_y = dy * para->scroll_dist_vert;
+
+    priv->autoscroll_x += dx;
+    priv->autoscroll_y += dy;
+    while (priv->autoscroll_y > 1.0) {
+	sd.down++;
+	priv->autoscroll_y -= 1.0;
+    }
+    while (priv->autoscroll_y < -1.0) {
+	sd.up++;
+	priv->autoscroll_y += 1.0;
+    }
+    while (priv->autoscroll_x > 1.0) {
+	sd.right++;
+	priv->autoscroll_x -= 1.0;
+    }
+    while (priv->autoscroll_x < -1.0) {
+	sd.left++;
+	priv->autoscroll_x += 1.0;
+    }
+    post_scroll_events(pInfo, sd);
+
+    if (!active) {
+	DBG(7, "coasting ended\n");
+	return 1000000000;
+    }
+    return frame_delay(priv);
 }
 
 static inline int
 repeat_scrollbuttons(const InputInfoPtr pInfo,
                      const struct SynapticsHwState *hw,
-		     int buttons, int delay)
+		     int buttons, int delay, Bool *posted)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
+    const SynapticsParameters *para = &priv->cp->para;
     int repeat_delay, timeleft;
     int rep_buttons = ((para->updown_button_repeat ? 0x18 : 0) |
 			(para->leftright_button_repeat ? 0x60 : 0));
 
     /* Handle auto repeat buttons */
-    repeat_delay = clamp(para->scroll_button_repeat, SBR_MIN, SBR_MAX);
+    repeat_delay = priv->cp->scroll_repeat_delay;
     if (((hw->up || hw->down) && para->updown_button_repeat &&
 	 para->updown_button_scrolling) ||
-	((hw->multi[2] || hw->multi[3]) && para->leftright_button_repeat &&
+	((HW_MULTI(hw, 2) || HW_MULTI(hw, 3)) && para->leftright_button_repeat &&
 	 para->leftright_button_scrolling)) {
 	priv->repeatButtons = buttons & rep_buttons;
 	if (!priv->nextRepeat) {
@@ -2618,6 +3451,7 @@ repeat_scrollbuttons(const InputInfoPtr pInfo,
 		change &= ~(1 << (id - 1));
 		xf86PostButtonEvent(pInfo->dev, FALSE, id, FALSE, 0, 0);
 		xf86PostButtonEvent(pInfo->dev, FALSE, id, TRUE, 0, 0);
+		*posted = TRUE;
 	    }
 
 	    priv->nextRepeat = hw->millis + repeat_delay;
@@ -2628,48 +3462,50 @@ repeat_scrollbuttons(const InputInfoPtr pInfo,
     return delay;
 }
 
-/*
- * React on changes in the hardware state. This function is called every time
- * the hardware state changes. The return value is used to specify how many
- * milliseconds to wait before calling the function again if no state change
- * occurs.
- */
-int
-HandleState(InputInfoPtr pInfo, struct SynapticsHwState *hw)
-{
-    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
+/* what the HandleState stages hand on to each other */
+struct FrameState {
+    struct SynapticsHwState *hw;
+    Bool inside_active_area;
     int finger;
-    int dx, dy, buttons, id;
-    edge_type edge = NO_EDGE;
-    int change;
+    edge_type edge;
+    int dx, dy;
     struct ScrollData scroll;
-    int double_click = FALSE;
-    int delay = 1000000000;
-    int timeleft;
-    Bool inside_active_area;
+    int double_click;
+    Bool store_history;			/* add the position to the movement history */
+    int delay;
+    Bool posted;			/* stage_post sent events to the server */
+};
 
-    update_shm(pInfo, hw);
+typedef void (*FrameStageProc)(InputInfoPtr pInfo, SynapticsPrivate *priv,
+			       struct FrameState *fs);
 
-    /* If touchpad is switched off, we skip the whole thing and return delay */
-    if (para->touchpad_off == 1)
-	return delay;
+/* apply hysteresis before doing anything serious. This cancels
+ * out a lot of noise which might surface in strange phenomena
+ * like flicker in scrolling or noise motion. */
+static void
+stage_hysteresis(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    const SynapticsParameters *para = &priv->cp->para;
+    struct SynapticsHwState *hw = fs->hw;
 
-    /* apply hysteresis before doing anything serious. This cancels
-     * out a lot of noise which might surface in strange phenomena
-     * like flicker in scrolling or noise motion. */
     priv->hyst_center_x = hysteresis(hw->x, priv->hyst_center_x, para->hyst_x);
     priv->hyst_center_y = hysteresis(hw->y, priv->hyst_center_y, para->hyst_y);
     hw->x = priv->hyst_center_x;
     hw->y = priv->hyst_center_y;
+}
+
+static void
+stage_area(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    struct SynapticsHwState *hw = fs->hw;
 
-    inside_active_area = is_inside_active_area(priv, hw->x, hw->y);
+    fs->inside_active_area = is_inside_active_area(priv, hw->x, hw->y);
 
     /* now we know that these _coordinates_ aren't in the area.
        invalid are: x, y, z, numFingers, fingerWidth
        valid are: millis, left/right/middle/up/down/etc.
     */
-    if (!inside_active_area)
+    if (!fs->inside_active_area)
     {
 	hw->x = 0;
 	hw->y = 0;
@@ -2679,67 +3515,118 @@ HandleState(InputInfoPtr pInfo, struct SynapticsHwState *hw)
 
 	/* FIXME: if finger accidentally moves into the area and doesn't
 	 * really release, the finger should remain down. */
-	finger = FS_UNTOUCHED;
-	edge = NO_EDGE;
-
-	dx = dy = 0;
     }
+}
 
-    /* these two just update hw->left, right, etc. */
-    update_hw_button_state(pInfo, hw, &delay);
-    if (priv->has_scrollbuttons)
-	double_click = adjust_state_from_scrollbuttons(pInfo, hw);
+/* 3rd button emulation */
+static void
+stage_midbutton(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    fs->hw->middle |= HandleMidButtonEmulation(priv, fs->hw, &fs->delay);
+}
 
-    /* no edge or finger detection outside of area */
-    if (inside_active_area) {
-	edge = edge_detection(priv, hw->x, hw->y);
-	finger = SynapticsDetectFinger(priv, hw);
-    }
+/* these two just update hw->left, right, etc. */
+static void
+stage_buttons(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    update_hw_button_state(pInfo, fs->hw);
+}
+
+static void
+stage_scrollbuttons(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    fs->double_click = adjust_state_from_scrollbuttons(pInfo, fs->hw);
+}
+
+/* no edge or finger detection outside of area */
+static void
+stage_edges(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    if (fs->inside_active_area)
+	fs->edge = edge_detection(priv, fs->hw->x, fs->hw->y);
+}
+
+static void
+stage_finger(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    if (fs->inside_active_area)
+	fs->finger = SynapticsDetectFinger(priv, fs->hw);
+}
+
+/* tap and drag detection. Needs to be performed even if the finger is in
+ * the dead area to reset the state. */
+static void
+stage_tap(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    int timeleft;
 
-    /* tap and drag detection. Needs to be performed even if the finger is in
-     * the dead area to reset the state. */
-    timeleft = HandleTapProcessing(priv, hw, finger, inside_active_area);
+    timeleft = HandleTapProcessing(priv, fs->hw, fs->finger, fs->inside_active_area);
     if (timeleft > 0)
-	delay = MIN(delay, timeleft);
+	fs->delay = MIN(fs->delay, timeleft);
+}
 
-    if (inside_active_area)
-    {
-	/* Don't bother about scrolling in the dead area of the touchpad. */
-	timeleft = HandleScrolling(priv, hw, edge, finger, &scroll);
-	if (timeleft > 0)
-	    delay = MIN(delay, timeleft);
+/* Don't bother about scrolling in the dead area of the touchpad. */
+static void
+stage_scroll(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    int timeleft;
 
-	/*
-	 * Compensate for unequal x/y resolution. This needs to be done after
-	 * calculations that require unadjusted coordinates, for example edge
-	 * detection.
-	 */
-	ScaleCoordinates(priv, hw);
-//    DBG(7, "After Scale: X=%d, Y=%d\n", hw->x, hw->y);
-    }
+    if (!fs->inside_active_area)
+	return;
 
-    dx = dy = 0;
+    timeleft = HandleScrolling(priv, fs->hw, fs->edge, fs->finger, &fs->scroll);
+    if (timeleft > 0)
+	fs->delay = MIN(fs->delay, timeleft);
+}
 
-    if (!priv->absolute_events) {
-      timeleft = ComputeDeltas(priv, hw, edge, &dx, &dy, inside_active_area);
-      delay = MIN(delay, timeleft);
-    }
+/*
+ * Compensate for unequal x/y resolution. This needs to be done after
+ * calculations that require unadjusted coordinates, for example edge
+ * detection.
+ */
+static void
+stage_scale(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    if (fs->inside_active_area)
+	ScaleCoordinates(priv, fs->hw);
+}
+
+static void
+stage_deltas(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    int timeleft;
+
+    timeleft = ComputeDeltas(priv, fs->hw, fs->edge, &fs->dx, &fs->dy,
+			     fs->inside_active_area);
+    fs->delay = MIN(fs->delay, timeleft);
+    if (gesture_holds_pointer(priv, fs->hw))
+	fs->dx = fs->dy = 0;
+    fs->store_history = TRUE;
+}
 
+static void
+stage_post(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    const SynapticsParameters *para = &priv->cp->para;
+    struct SynapticsHwState *hw = fs->hw;
+    int buttons, change, id;
 
     buttons = ((hw->left     ? 0x01 : 0) |
 	       (hw->middle   ? 0x02 : 0) |
 	       (hw->right    ? 0x04 : 0) |
 	       (hw->up       ? 0x08 : 0) |
 	       (hw->down     ? 0x10 : 0) |
-	       (hw->multi[2] ? 0x20 : 0) |
-	       (hw->multi[3] ? 0x40 : 0));
+	       (HW_MULTI(hw, 2) ? 0x20 : 0) |
+	       (HW_MULTI(hw, 3) ? 0x40 : 0));
 
     if (priv->tap_button > 0) {
 	int tap_mask = 1 << (priv->tap_button - 1);
 	if (priv->tap_button_state == TBS_BUTTON_DOWN_UP) {
 	    if (tap_mask != (priv->lastButtons & tap_mask)) {
+		resample_flush(pInfo);
 		xf86PostButtonEvent(pInfo->dev, FALSE, priv->tap_button, TRUE, 0, 0);
 		priv->lastButtons |= tap_mask;
+		fs->posted = TRUE;
 	    }
 	    priv->tap_button_state = TBS_BUTTON_UP;
 	}
@@ -2748,27 +3635,37 @@ HandleState(InputInfoPtr pInfo, struct SynapticsHwState *hw)
     }
 
     /* Post events */
-    if (finger > FS_UNTOUCHED) {
-        if (priv->absolute_events && inside_active_area) {
+    if (fs->finger > FS_UNTOUCHED) {
+        if (priv->absolute_events && fs->inside_active_area) {
             xf86PostMotionEvent(pInfo->dev, 1, 0, 2, hw->x, hw->y);
-        } else if (dx || dy) {
-//        	yolog_debug("Posting MotionEvent: %d,%d", dx,dy);
-            xf86PostMotionEvent(pInfo->dev, 0, 0, 2, dx, dy);
-
+            fs->posted = TRUE;
+        } else if (fs->dx || fs->dy) {
+            post_relative_motion(pInfo, fs->dx, fs->dy, hw->millis);
+            fs->posted = TRUE;
         }
+    } else if (para->predict_horizon > 0 && (fs->dx || fs->dy)) {
+        /* finger lifted while the pointer was ahead of it */
+        post_relative_motion(pInfo, fs->dx, fs->dy, hw->millis);
+        fs->posted = TRUE;
     }
 
     if (priv->mid_emu_state == MBE_LEFT_CLICK)
     {
 	post_button_click(pInfo, 1);
 	priv->mid_emu_state = MBE_OFF;
+	fs->posted = TRUE;
     } else if (priv->mid_emu_state == MBE_RIGHT_CLICK)
     {
 	post_button_click(pInfo, 3);
 	priv->mid_emu_state = MBE_OFF;
+	fs->posted = TRUE;
     }
 
     change = buttons ^ priv->lastButtons;
+    if (change) {
+	resample_flush(pInfo);
+	fs->posted = TRUE;
+    }
     while (change) {
 	id = ffs(change); /* number of first set bit 1..32 is returned */
 	change &= ~(1 << (id - 1));
@@ -2779,26 +3676,209 @@ HandleState(InputInfoPtr pInfo, struct SynapticsHwState *hw)
     /* Process scroll events only if coordinates are
      * in the Synaptics Area
      */
-    if (inside_active_area)
-	post_scroll_events(pInfo, scroll);
+    if (fs->inside_active_area) {
+	post_scroll_events(pInfo, fs->scroll);
+    }
 
-    if (double_click) {
+    if (fs->double_click) {
 	post_button_click(pInfo, 1);
 	post_button_click(pInfo, 1);
+	fs->posted = TRUE;
     }
 
     if (priv->has_scrollbuttons)
-	delay = repeat_scrollbuttons(pInfo, hw, buttons, delay);
+	fs->delay = repeat_scrollbuttons(pInfo, hw, buttons, fs->delay, &fs->posted);
 
     /* Save old values of some state variables */
-    priv->finger_state = finger;
+    priv->finger_state = fs->finger;
+    priv->frame_edge = fs->edge;
     priv->lastButtons = buttons;
 
     /* generate a history of the absolute positions */
-    if (inside_active_area)
+    if (fs->inside_active_area && fs->store_history)
 	store_history(priv, hw->x, hw->y, hw->millis);
+}
 
-    return delay;
+/* only laid out when a gesture has a button or key to report */
+static void
+stage_gestures(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs)
+{
+    if (fs->inside_active_area && fs->hw->contacts.moved)
+	handle_gestures(pInfo, fs->hw);
+}
+
+static const struct {
+    const char *name;
+    FrameStageProc proc;
+} frame_stages[SYN_STAGES] = {
+    [STAGE_HYSTERESIS]    = { "hysteresis",    stage_hysteresis },
+    [STAGE_AREA]          = { "area",          stage_area },
+    [STAGE_MIDBUTTON]     = { "midbutton",     stage_midbutton },
+    [STAGE_BUTTONS]       = { "buttons",       stage_buttons },
+    [STAGE_SCROLLBUTTONS] = { "scrollbuttons", stage_scrollbuttons },
+    [STAGE_EDGES]         = { "edges",         stage_edges },
+    [STAGE_FINGER]        = { "finger",        stage_finger },
+    [STAGE_TAP]           = { "tap",           stage_tap },
+    [STAGE_SCROLL]        = { "scroll",        stage_scroll },
+    [STAGE_SCALE]         = { "scale",         stage_scale },
+    [STAGE_DELTAS]        = { "deltas",        stage_deltas },
+    [STAGE_POST]          = { "post",          stage_post },
+    [STAGE_GESTURES]      = { "gestures",      stage_gestures },
+};
+
+static unsigned long long
+stage_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+log_stage_stats(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    int i;
+
+    for (i = 0; i < SYN_STAGES; i++) {
+	const SynapticsStageStats *st = &priv->stage_stats[i];
+
+	if (st->calls)
+	    DBG(4, "%s: stage %s: %lu frames, %.0f ns average, %lu ns max\n",
+		pInfo->name, frame_stages[i].name, st->calls,
+		(double)st->total_ns / st->calls, st->max_ns);
+    }
+    DBG(4, "%s: timer: %lu wakeups, %lu with work due, %lu re-arms\n",
+	pInfo->name, priv->timer_wakeups, priv->timer_useful, priv->timer_rearms);
+}
+
+static void
+frame_state_init(struct FrameState *fs, struct SynapticsHwState *hw)
+{
+    memset(fs, 0, sizeof(*fs));
+    fs->hw = hw;
+    fs->inside_active_area = TRUE;
+    fs->finger = FS_UNTOUCHED;
+    fs->edge = NO_EDGE;
+    fs->store_history = TRUE;
+    fs->delay = 1000000000;
+}
+
+/*
+ * Whether a stage has anything to do on an idle tick, i.e. without a new
+ * hardware frame. Finger and edge detection and scrolling only react to new
+ * input, their results are taken over from the last frame. The stages
+ * preparing the input and posting always run.
+ */
+static Bool
+stage_ticks(SynapticsPrivate *priv, enum SynapticsStage stage)
+{
+    switch (stage) {
+    case STAGE_EDGES:
+    case STAGE_FINGER:
+    case STAGE_SCROLL:
+    case STAGE_GESTURES:
+	return FALSE;
+    case STAGE_TAP:
+	return tap_timeout[priv->tap_state] >= 0;
+    case STAGE_DELTAS:
+	return priv->pred_return_frames ||
+	       (priv->finger_state > FS_UNTOUCHED &&
+		motion_delay(priv, HIST(0).x, HIST(0).y, priv->frame_edge) < 1000000000);
+    default:
+	return TRUE;
+    }
+}
+
+static void
+run_stages(InputInfoPtr pInfo, SynapticsPrivate *priv, struct FrameState *fs, Bool tick)
+{
+    const SynapticsCompiledParams *cp = priv->cp;
+    unsigned long long start, end;
+    int i;
+
+    for (i = 0; i < cp->num_stages; i++) {
+	SynapticsStageStats *st = &priv->stage_stats[cp->stages[i]];
+
+	if (tick && !stage_ticks(priv, cp->stages[i]))
+	    continue;
+
+	if (!cp->time_stages) {
+	    frame_stages[cp->stages[i]].proc(pInfo, priv, fs);
+	    continue;
+	}
+
+	start = stage_clock();
+	frame_stages[cp->stages[i]].proc(pInfo, priv, fs);
+	end = stage_clock();
+	st->calls++;
+	st->total_ns += end - start;
+	if (end - start > st->max_ns)
+	    st->max_ns = end - start;
+    }
+}
+
+/*
+ * React on changes in the hardware state. This function is called every time
+ * the hardware state changes. The return value is used to specify how many
+ * milliseconds to wait before calling the function again if no state change
+ * occurs. The work is done by the stages SynapticsCompileParams() laid out
+ * for the current configuration, each timed into priv->stage_stats when the
+ * log is verbose enough to report them.
+ */
+int
+HandleState(InputInfoPtr pInfo, struct SynapticsHwState *hw)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    struct FrameState fs;
+
+    update_shm(pInfo, hw);
+
+    /* If touchpad is switched off, there are no stages and we return delay */
+    frame_state_init(&fs, hw);
+    run_stages(pInfo, priv, &fs, FALSE);
+
+    return fs.delay;
+}
+
+/*
+ * The timer side of HandleState, for when no new frame came in: advance the
+ * clock driven state machines that are waiting on a deadline - tap
+ * timeouts, mid button emulation, edge motion, scroll button repeat - from
+ * the last frame and post what they produce. Returns the delay like
+ * HandleState, posted tells whether anything was sent to the server.
+ */
+static Bool
+idle_tick_pending(SynapticsPrivate *priv)
+{
+    return priv->mid_emu_state == MBE_LEFT || priv->mid_emu_state == MBE_RIGHT ||
+	   stage_ticks(priv, STAGE_TAP) || stage_ticks(priv, STAGE_DELTAS) ||
+	   priv->repeatButtons;
+}
+
+static int
+idle_tick(InputInfoPtr pInfo, int now, Bool *posted)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+    struct SynapticsHwState hw;
+    struct FrameState fs;
+
+    if (!idle_tick_pending(priv))
+	return 1000000000;
+
+    hw = priv->comm.hwState;
+    hw.millis = now;
+    hw.contacts.moved = FALSE;
+
+    frame_state_init(&fs, &hw);
+    fs.finger = priv->finger_state;
+    fs.edge = priv->frame_edge;
+    fs.store_history = FALSE;
+    run_stages(pInfo, priv, &fs, TRUE);
+
+    *posted = fs.posted;
+    return fs.delay;
 }
 
 static int
@@ -2830,6 +3910,9 @@ SwitchMode(ClientPtr client, DeviceIntPtr dev, int mode)
         return XI_BadMode;
     }
 
+    /* the pipeline depends on the mode */
+    SynapticsCompileParams(priv);
+
     return Success;
 }
 
@@ -2862,27 +3945,8 @@ QueryHardware(InputInfoPtr pInfo)
 static void
 ScaleCoordinates(SynapticsPrivate *priv, struct SynapticsHwState *hw)
 {
-    int xCenter = (priv->synpara.left_edge + priv->synpara.right_edge) / 2;
-    int yCenter = (priv->synpara.top_edge + priv->synpara.bottom_edge) / 2;
-
-    hw->x = (hw->x - xCenter) * priv->horiz_coeff + xCenter;
-    hw->y = (hw->y - yCenter) * priv->vert_coeff + yCenter;
-}
-
-void
-CalculateScalingCoeffs(SynapticsPrivate *priv)
-{
-    int vertRes = priv->synpara.resolution_vert;
-    int horizRes = priv->synpara.resolution_horiz;
+    const SynapticsCompiledParams *cp = priv->cp;
 
-    if ((horizRes > vertRes) && (horizRes > 0)) {
-        priv->horiz_coeff = vertRes / (double)horizRes;
-        priv->vert_coeff = 1;
-    } else if ((horizRes < vertRes) && (vertRes > 0)) {
-        priv->horiz_coeff = 1;
-        priv->vert_coeff = horizRes / (double)vertRes;
-    } else {
-        priv->horiz_coeff = 1;
-        priv->vert_coeff = 1;
-    }
+    hw->x = (hw->x - cp->scale_center_x) * cp->horiz_coeff + cp->scale_center_x;
+    hw->y = (hw->y - cp->scale_center_y) * cp->vert_coeff + cp->scale_center_y;
 }
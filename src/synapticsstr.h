@@ -23,9 +23,20 @@
 #define _SYNAPTICSSTR_H_
 
 #include <linux/input.h>
+#include <stddef.h>
 
 #include "synproto.h"
 #include "synhist.h"
+#include "kinetic.h"
+#include "gesture.h"
+#include "taptable.h"
+#include "arena.h"
+#include "zonemap.h"
+#include "yolog.h"
+
+#if GET_ABI_MAJOR(ABI_XINPUT_VERSION) >= 14
+#define HAVE_SMOOTH_SCROLL
+#endif
 
 #define DEBUG
 #ifdef DBG
@@ -39,6 +50,26 @@
 #define DBG(verb, msg, ...) /* */
 #endif
 
+/* Messages from the SIGIO handler, where nothing may allocate or lock.
+ * Older servers have no signal safe logging, X_NONE doesn't allocate.
+ * Each call site is rate limited like the yolog macros. */
+#if GET_ABI_MAJOR(ABI_XINPUT_VERSION) >= 18
+#define SIGMSG_LOG(type, verb, ...) \
+    LogMessageVerbSigSafe(type, verb, __VA_ARGS__)
+#else
+#define SIGMSG_LOG(type, verb, ...) \
+    xf86MsgVerb(X_NONE, verb, __VA_ARGS__)
+#endif
+#define SIGMSG(type, verb, ...) do { \
+    static yolog_ratelimit _rl; \
+    unsigned long _suppressed; \
+    if (yolog_ratelimit_pass(&_rl, &_suppressed)) { \
+	if (_suppressed) \
+	    SIGMSG_LOG(type, verb, "%lu messages suppressed\n", _suppressed); \
+	SIGMSG_LOG(type, verb, __VA_ARGS__); \
+    } \
+} while (0)
+
 /******************************************************************************
  *		Definitions
  *					structs, typedefs, #defines, enums
@@ -49,6 +80,18 @@
 #define POS_OOB 999999
 #define SCROLL_IDX_Y_AVG 0
 #define SCROLL_IDX_X_AVG 1
+#define SYNAPTICS_FRAME_TIME_DEFAULT 12.5   /* ms, 80 packets/s until measured */
+#define SYN_ACCEL_TABLE_SIZE 256	    /* entries in the velocity -> accel factor table */
+#define SYN_ACCEL_CURVE_MAX 32		    /* max values in a user supplied accel curve */
+#define SYN_PRESSURE_BUCKETS 32		    /* entries in the pressure -> speed factor table */
+#define SYN_CACHE_LINE 64		    /* SynapticsPrivate alignment */
+#define SYN_MIN_KEYCODE 8		    /* the range of X keycodes for gesture keys */
+#define SYN_MAX_KEYCODE 255
+#ifdef HAVE_SMOOTH_SCROLL
+#define SYN_NUM_AXES 4			    /* x, y, horizontal and vertical scroll */
+#else
+#define SYN_NUM_AXES 2
+#endif
 
 
 typedef struct _SynapticsMoveHist
@@ -80,26 +123,6 @@ enum MidButtonEmulation {
     MBE_RIGHT_CLICK,		/* Emulate right button click. */
 };
 
-/* See docs/tapndrag.dia for a state machine diagram */
-enum TapState {
-    TS_START,			/* No tap/drag in progress */
-    TS_1,			/* After first touch */
-    TS_MOVE,			/* Pointer movement enabled */
-    TS_2A,			/* After first release */
-    TS_2B,			/* After second/third/... release */
-    TS_SINGLETAP,		/* After timeout after first release */
-    TS_3,			/* After second touch */
-    TS_DRAG,			/* Pointer drag enabled */
-    TS_4,			/* After release when "locked drags" enabled */
-    TS_5			/* After touch when "locked drags" enabled */
-};
-
-enum TapButtonState {
-    TBS_BUTTON_UP,		/* "Virtual tap button" is up */
-    TBS_BUTTON_DOWN,		/* "Virtual tap button" is down */
-    TBS_BUTTON_DOWN_UP		/* Send button down event + set up state */
-};
-
 enum TouchpadModel {
     MODEL_UNKNOWN = 0,
     MODEL_SYNAPTICS,
@@ -107,6 +130,31 @@ enum TouchpadModel {
     MODEL_APPLETOUCH
 };
 
+enum SynapticsStage {		/* HandleState stages in the order they run */
+    STAGE_HYSTERESIS = 0,
+    STAGE_AREA,
+    STAGE_MIDBUTTON,
+    STAGE_BUTTONS,
+    STAGE_SCROLLBUTTONS,
+    STAGE_EDGES,
+    STAGE_FINGER,
+    STAGE_TAP,
+    STAGE_SCROLL,
+    STAGE_SCALE,
+    STAGE_DELTAS,
+    STAGE_POST,
+    STAGE_GESTURES,
+    SYN_STAGES
+};
+
+enum SoftButtonArea {		/* clickpad button areas, the rest of their band is left */
+    RIGHT_BUTTON_AREA = 0,
+    MIDDLE_BUTTON_AREA,
+    SOFTBUTTON_AREAS
+};
+
+SYN_STATIC_ASSERT(softbutton_areas, SOFTBUTTON_AREAS == ZONE_BUTTON_AREAS);
+
 typedef struct _SynapticsParameters
 {
     /* Parameter data */
@@ -152,6 +200,8 @@ typedef struct _SynapticsParameters
     int locked_drag_time;		    /* timeout for locked drags */
     int tap_action[MAX_TAP];		    /* Button to report on tap events */
     int click_action[MAX_CLICK];	    /* Button to report on click with fingers */
+    int gesture_action[MAX_GESTURE];	    /* Button to report on multi-finger gestures */
+    int gesture_key[MAX_GESTURE];	    /* Keycode to report on multi-finger gestures */
     Bool circular_scrolling;		    /* Enable circular scrolling */
     double scroll_dist_circ;		    /* Scrolling angle radians */
     int circular_trigger;		    /* Trigger area for circular scrolling */
@@ -159,8 +209,11 @@ typedef struct _SynapticsParameters
     Bool palm_detect;			    /* Enable Palm Detection */
     int palm_min_width;			    /* Palm detection width */
     int palm_min_z;			    /* Palm detection depth */
+    int thumb_min_major;		    /* Touch major at which a contact is a thumb */
+    int palm_min_major;			    /* Touch major at which a contact is a palm */
     double coasting_speed;		    /* Coasting threshold scrolling speed */
     double coasting_friction;		    /* Number of scrolls per second per second to change coasting speed */
+    double coasting_decay;		    /* Time constant of exponential coasting slowdown in ms, 0 for none */
     int press_motion_min_z;		    /* finger pressure at which minimum pressure motion factor is applied */
     int press_motion_max_z;		    /* finger pressure at which maximum pressure motion factor is applied */
     double press_motion_min_factor;	    /* factor applied on speed when finger pressure is at minimum */
@@ -172,9 +225,54 @@ typedef struct _SynapticsParameters
     unsigned int resolution_vert;           /* vertical resolution of touchpad in units/mm */
     int area_left_edge, area_right_edge, area_top_edge, area_bottom_edge; /* area coordinates absolute */
     int hyst_x, hyst_y;                     /* x and y width of hysteresis box */
+    float accel_curve[SYN_ACCEL_CURVE_MAX]; /* user accel curve: max velocity, then factors */
+    int accel_curve_len;		    /* number of values in accel_curve, 0 for built-in */
+    double predict_horizon;		    /* ms to extrapolate the pointer ahead, 0 disables */
+    double predict_damping;		    /* 0..1, smoothing of the predicted offset */
+    int resample_rate;			    /* motion events per second, 0 posts every frame */
+    int softbutton_areas[SOFTBUTTON_AREAS][4]; /* right, middle button area: left, right, top,
+					     * bottom, INT_MIN or INT_MAX for an open edge */
 
 } SynapticsParameters;
 
+/*
+ * What the frame path reads: a snapshot of SynapticsParameters plus the
+ * values derived from it, see SynapticsCompileParams().
+ */
+typedef struct _SynapticsCompiledParams
+{
+    SynapticsParameters para;		/* snapshot of synpara */
+
+    /* Precomputed acceleration */
+    float accel_table[SYN_ACCEL_TABLE_SIZE + 1]; /* accel factor by velocity */
+    double accel_table_step;		/* velocity per table entry, in device units */
+    double accel_table_slope;		/* accel factor per entry past the end of the table */
+    float press_table[SYN_PRESSURE_BUCKETS + 1]; /* speed factor by finger pressure */
+    double press_table_scale;		/* table entries per unit of pressure */
+
+    /* Clickpad button zones */
+    Bool has_button_zones;		/* any soft button area is set up */
+
+    /* Geometry */
+    int scale_center_x, scale_center_y;	/* center the resolution scaling works around */
+    double horiz_coeff;			/* normalization factor for x coordinates */
+    double vert_coeff;			/* normalization factor for y coordinates */
+
+    int scroll_repeat_delay;		/* scroll_button_repeat clamped to SBR_MIN..SBR_MAX */
+    int resample_period;		/* ms between resampled motion events */
+    double circ_inv_delta;		/* 1 / scroll_dist_circ */
+    double coasting_speed_sq;		/* coasting_speed squared */
+    double coasting_tau;		/* coasting_decay in seconds */
+
+    /* Edges, active area and button zones with their map, see zonemap.h */
+    ZoneMap zones;
+
+    /* HandleState pipeline, the enabled stages only */
+    unsigned char stages[SYN_STAGES];	/* enum SynapticsStage, in order */
+    int num_stages;
+    Bool time_stages;			/* keep stage_stats, only logged at -verbose 4 */
+} SynapticsCompiledParams;
+
 typedef struct {
 	int x[SYNAPTICS_MOVE_HISTORY];
 	int y[SYNAPTICS_MOVE_HISTORY];
@@ -187,57 +285,58 @@ typedef struct {
 	int counter[2];
 } SynapticsScrollAvg;
 
+typedef struct {
+    unsigned long calls;		/* frames the stage ran for */
+    unsigned long long total_ns;	/* time spent in the stage */
+    unsigned long max_ns;		/* longest single run */
+} SynapticsStageStats;
+
 typedef struct _SynapticsPrivateRec
 {
-    SynapticsParameters synpara;            /* Default parameter settings, read from
-					       the X config file */
-    SynapticsSHM *synshm;		     /* Current parameter settings. Will point to
-					        shared memory if shm_config is true */
-    struct SynapticsProtocolOperations* proto_ops;
-    void *proto_data;			/* protocol-specific data */
-
-    struct SynapticsHwState hwState;
-
-    Bool shm_config;			/* True when shared memory area allocated */
-
-    OsTimerPtr timer;			/* for up/down-button repeat, tap processing, etc */
-
-    struct CommData comm;
-
-    Bool absolute_events;               /* post absolute motion events instead of relative */
-
-    SynapticsMoveHistRec move_hist[SYNAPTICS_MOVE_HISTORY]; /* movement history */
-
-    /*First is f1, second is f2, third is averages*/
-//    SynhistLog scroll_hist_y[3];
-//    SynhistLog scroll_hist_x[3];
-
-    SynhistLog scroll_hist[SYNAPTICS_METRIC_COUNT][3];
+    /*
+     * Per-frame state. HandleState() reads and writes all of this on every
+     * frame, roughly in the order given, so it is kept together at the start
+     * of the (cache line aligned) struct; the comments mark the lines,
+     * which are checked after the struct. Configuration and other cold
+     * data follow at the end.
+     */
+
+    /* line 0: read by nearly every stage */
+    const SynapticsCompiledParams *cp;      /* settings in use by the frame path */
+    enum FingerState finger_state;	/* previous finger state */
+    enum TapState tap_state;		/* State of tap processing */
+    enum MovingState moving_state;	/* previous moving state */
+    enum MidButtonEmulation mid_emu_state;	/* emulated 3rd button */
     int hist_index;			/* Last added entry in move_hist[] */
+    int count_packet_finger;		/* packet counter with finger on the touchpad */
+    int prevFingers;			/* previous numFingers, for transition detection */
+    int prev_z;				/* previous z value, for palm detection */
+    int avg_width;			/* weighted average of previous fingerWidth values */
+    int palm;				/* Set to true when palm detected, reset to false when
+					   palm/finger contact disappears */
+    int frame_edge;			/* edges of the last frame, for idle_tick() */
+    int lastButtons;			/* last state of the buttons */
     int hyst_center_x;			/* center x of hysteresis*/
     int hyst_center_y;			/* center y of hysteresis*/
-    int scroll_y;			/* last y-scroll position */
-    int scroll_x;			/* last x-scroll position */
-    double scroll_a;			/* last angle-scroll position */
 
-    int count_packet_finger;		/* packet counter with finger on the touchpad */
-
-    /*Packet counters for scroll history*/
-    int count_scroll_finger;
-    int scroll_last_delta_y;
-    int scroll_last_delta_x;
+    /* lines 1-2: motion */
+    SynapticsMoveHistRec move_hist[SYNAPTICS_MOVE_HISTORY]; /* movement history */
+    int frame_millis;			/* time of the last batch of hardware frames */
+    int state_millis;			/* next time HandleState() wants to run */
 
-    int button_delay_millis;		/* button delay for 3rd button emulation */
-    Bool prev_up;			/* Previous up button value, for double click emulation */
-    enum FingerState finger_state;	/* previous finger state */
+    /* line 3: the last complete hardware frame, also read by timerFunc(),
+     * the protocol's packet state follows */
+    struct CommData comm;
 
-    enum TapState tap_state;		/* State of tap processing */
+    /* tap, button and scroll mode state */
     int tap_max_fingers;		/* Max number of fingers seen since entering start state */
     int tap_button;			/* Which button started the tap processing */
     enum TapButtonState tap_button_state; /* Current tap action */
     SynapticsMoveHistRec touch_on;	/* data when the touchpad is touched/released */
-
-    enum MovingState moving_state;	/* previous moving state */
+    int button_delay_millis;		/* button delay for 3rd button emulation */
+    Bool prev_up;			/* Previous up button value, for double click emulation */
+    int repeatButtons;			/* buttons for repeat */
+    int nextRepeat;			/* Time when to trigger next auto repeat event */
     Bool vert_scroll_edge_on;		/* Keeps track of currently active scroll modes */
     Bool horiz_scroll_edge_on;		/* Keeps track of currently active scroll modes */
     Bool vert_scroll_twofinger_on;	/* Keeps track of currently active scroll modes */
@@ -245,28 +344,95 @@ typedef struct _SynapticsPrivateRec
     Bool circ_scroll_on;		/* Keeps track of currently active scroll modes */
     Bool circ_scroll_vert;		/* True: Generate vertical scroll events
 					   False: Generate horizontal events */
+    int amt_last_action;		/* gesture action held since the click */
+
+    /* relative motion, frame timing and the timer */
+    double frac_x, frac_y;		/* absolute -> relative fraction */
     int trackstick_neutral_x;		/* neutral x position for trackstick mode */
     int trackstick_neutral_y;		/* neutral y position for trackstick mode */
-    double autoscroll_xspd;		/* Horizontal coasting speed */
-    double autoscroll_yspd;		/* Vertical coasting speed */
+    double frame_time;			/* estimated time between hardware frames in ms */
+    Bool timer_armed;			/* priv->timer is set, see set_timer() */
+    CARD32 timer_deadline;		/* when it fires */
+
+    /* Motion resampling, see resample_tick() */
+    Bool resample_active;		/* motion still to be posted */
+    int resample_millis;		/* arrival time of the last frame */
+    int resample_next;			/* time of the next resampler tick */
+    double resample_from_x, resample_from_y; /* position at resample_millis */
+    double resample_to_x, resample_to_y; /* position one frame after resample_millis */
+    double resample_posted_x, resample_posted_y; /* position posted so far */
+
+    /* Pointer prediction, see predict_delta() */
+    double pred_x, pred_y;		/* offset the pointer is ahead of the finger */
+    double pred_dx, pred_dy;		/* finger delta of the previous frame */
+    double pred_target_x, pred_target_y; /* predicted finger position ... */
+    int pred_target_millis;		/* ... at this time, 0 if none pending */
+    int pred_err_count;			/* number of predictions checked */
+    double pred_base_x, pred_base_y;	/* finger position when the prediction was made */
+    double pred_err, pred_base_err;	/* summed squared error with/without prediction */
+    double pred_owed_x, pred_owed_y;	/* dropped lead still to be given back ... */
+    int pred_return_frames;		/* ... over this many more frames */
+
+    /* Scrolling, touched only while a scroll mode is on */
+    int scroll_y;			/* last y-scroll position */
+    int scroll_x;			/* last x-scroll position */
+    double scroll_a;			/* last angle-scroll position */
+    double scroll_smooth_a;		/* last angle sent as smooth scroll */
+    int scroll_smooth_pos[SYNAPTICS_METRIC_COUNT]; /* last two-finger position sent as smooth scroll */
+    Bool scroll_onset[SYNAPTICS_METRIC_COUNT]; /* two-finger scroll committed to */
+    double scroll_onset_start[SYNAPTICS_METRIC_COUNT]; /* contact centroid at scroll start */
+    double scroll_onset_spread[SYNAPTICS_METRIC_COUNT]; /* contact spread at scroll start */
+    int scroll_start_millis[SYNAPTICS_METRIC_COUNT]; /* scroll start, 0 once the first step was sent */
+    /*Packet counters for scroll history*/
+    int count_scroll_finger;
+    int scroll_last_delta_y;
+    int scroll_last_delta_x;
+    int scroll_packet_count;		/* Scroll duration */
+    SynhistLog scroll_hist[SYNAPTICS_METRIC_COUNT]; /* contact centroid while scrolling */
+    KineticScroll kinetic;		/* coasting state and speed */
     double autoscroll_x;		/* Accumulated horizontal coasting scroll */
     double autoscroll_y;		/* Accumulated vertical coasting scroll */
-    int scroll_packet_count;		/* Scroll duration */
-    double frac_x, frac_y;		/* absolute -> relative fraction */
-    enum MidButtonEmulation mid_emu_state;	/* emulated 3rd button */
-    int repeatButtons;			/* buttons for repeat */
-    int nextRepeat;			/* Time when to trigger next auto repeat event */
-    int lastButtons;			/* last state of the buttons */
-    int palm;				/* Set to true when palm detected, reset to false when
-					   palm/finger contact disappears */
-    int prev_z;				/* previous z value, for palm detection */
-    int prevFingers;			/* previous numFingers, for transition detection */
-    int avg_width;			/* weighted average of previous fingerWidth values */
-    double horiz_coeff;                 /* normalization factor for x coordintes */
-    double vert_coeff;                  /* normalization factor for y coordintes */
+    GestureRecognizer gesture;		/* multi-finger gesture state */
+#ifdef HAVE_SMOOTH_SCROLL
+    ValuatorMask *scroll_events_mask;	/* scroll valuators posted per frame */
+#endif
+
+    /* Scale of the compiled acceleration table for the dix velocity */
+    double accel_table_scale;		/* table entries per unit of dix velocity */
+    float accel_const_acc;		/* dix constant deceleration accel_table_scale is for */
+    const SynapticsCompiledParams *accel_scale_cp; /* block accel_table_scale is for */
+    double frame_time_applied;		/* frame_time last handed to the dix velocity code */
+
+    /*
+     * Cold data: configuration, probed capabilities and statistics.
+     */
+
+    Arena arena;			/* all driver allocations for this device */
+    SynapticsParameters synpara;            /* Default parameter settings, read from
+					       the X config file */
+    SynapticsCompiledParams *compiled;      /* two blocks, double buffer behind cp */
+    SynapticsSHM *synshm;		     /* Current parameter settings. Will point to
+					        shared memory if shm_config is true */
+    struct SynapticsProtocolOperations* proto_ops;
+    void *proto_data;			/* protocol-specific data */
+
+    Bool shm_config;			/* True when shared memory area allocated */
+
+    OsTimerPtr timer;			/* for up/down-button repeat, tap processing, etc */
+
+    Bool absolute_events;               /* post absolute motion events instead of relative */
+
+    SynapticsStageStats stage_stats[SYN_STAGES]; /* HandleState time by stage, kept
+						    only with cp->time_stages */
+
+    /* Timer accounting, see set_timer() */
+    unsigned long timer_wakeups;	/* timerFunc calls */
+    unsigned long timer_useful;		/* ... with work due */
+    unsigned long timer_rearms;		/* TimerSet calls */
 
     int minx, maxx, miny, maxy;         /* min/max dimensions as detected */
     int minp, maxp, minw, maxw;		/* min/max pressure and finger width as detected */
+    int min_major, max_major;		/* min/max touch major as detected */
     int resx, resy;                     /* resolution of coordinates as detected in units/mm */
     Bool has_left;			/* left button detected for this device */
     Bool has_right;			/* right button detected for this device */
@@ -277,18 +443,27 @@ typedef struct _SynapticsPrivateRec
     Bool has_width;			/* device reports finger width */
     Bool has_scrollbuttons;		/* device has physical scrollbuttons */
     Bool has_touch;                     /* device has multitouch */
+    Bool has_gesture_keys;		/* a key class for gesture keys was set up */
 
     enum TouchpadModel model;          /* The detected model */
 
     /*Apple magic trackpad parameters*/
-    int amt_last_action;
     float amt_shift_slowdown; /*A factor by which we divide the delta, if there is a change during a click*/
-
-
-
 } SynapticsPrivate;
 
+/* The cache lines named in SynapticsPrivate, with 64 bit pointers. With 32
+ * bit ones cp is the only field that shrinks, so everything after it moves
+ * up by four bytes. */
+#define SYN_PRIV_OFFSET(field) (offsetof(SynapticsPrivate, field) + 8 - sizeof(void *))
+SYN_STATIC_ASSERT(priv_line_0, SYN_PRIV_OFFSET(move_hist) == SYN_CACHE_LINE);
+SYN_STATIC_ASSERT(priv_lines_1_2, SYN_PRIV_OFFSET(state_millis) + sizeof(int) <= 3 * SYN_CACHE_LINE);
+SYN_STATIC_ASSERT(priv_line_3, SYN_PRIV_OFFSET(comm) == 3 * SYN_CACHE_LINE);
+
 
 extern void SynapticsDefaultDimensions(InputInfoPtr pInfo);
+extern void SynapticsCompileParams(SynapticsPrivate *priv);
+#ifdef HAVE_SMOOTH_SCROLL
+extern void SynapticsSetScrollValuators(InputInfoPtr pInfo);
+#endif
 
 #endif /* _SYNAPTICSSTR_H_ */
@@ -55,17 +55,54 @@ typedef enum {
 
 #define SYNAPTICS_METRIC_COUNT 2
 
+typedef enum {
+	CONTACT_FINGER = 0,
+	CONTACT_THUMB,
+	CONTACT_PALM,
+} SynapticsContactClass;
+
 typedef struct {
 	/*Coordinates*/
 	int metric[SYNAPTICS_METRIC_COUNT];
 	int finger_id; /*Slot ID*/
 	uint32_t tracking_id;
 	Bool has_touch_event;
+	/*Position at the last report, for the contact rotation*/
+	int last_metric[SYNAPTICS_METRIC_COUNT];
+	Bool has_last;
+	/*Palm and thumb classification*/
+	int touch_major;
+	SynapticsContactClass contact_class;
+	int class_frames;	/*Reports the contact has looked like another class*/
+	Bool classified;	/*Classified since it landed*/
+	Bool rejected;		/*Left out of pointer, scroll and tap handling*/
+	Bool resting;		/*Landed in the clickpad button band and stayed there*/
+	int landing;		/*Axes of the landing position still to come, by metric bit*/
 } SynapticsFinger;
 
+/*
+ * Summary of all contacts taking part in multi-finger gestures (a finger
+ * holding down a clickpad is left out). Computed once per report by the
+ * protocol; fingers without an update in that report count at their last
+ * position. Kept in floats to keep the frame within a cache line.
+ */
+typedef struct {
+	int count;		/*Number of contacts*/
+	float centroid[SYNAPTICS_METRIC_COUNT];
+	float spread[SYNAPTICS_METRIC_COUNT];	/*RMS distance from the centroid, by axis*/
+	float rotation;		/*Radians turned around the centroid since the last report*/
+	Bool moved;		/*Whether any contact moved or came and went in this report*/
+} SynapticsContacts;
+
 
 /*
  * A structure to describe the state of the touchpad hardware (buttons and pad)
+ *
+ * CommData.hwState only ever holds complete frames: a protocol that
+ * assembles a frame from several reads builds it elsewhere and publishes it
+ * there once ReadHwState() returns TRUE, so timerFunc() can go on from the
+ * last frame whenever it fires. The layout is packed to a single cache
+ * line, so the buttons are bitfields.
  */
 struct SynapticsHwState {
     int millis;			/* Timestamp in milliseconds */
@@ -75,27 +112,34 @@ struct SynapticsHwState {
     int numFingers;
     int fingerWidth;
 
-    Bool left;
-    Bool right;
-    Bool up;
-    Bool down;
+    unsigned int left:1;
+    unsigned int right:1;
+    unsigned int up:1;
+    unsigned int down:1;
+    unsigned int middle:1;	/* Some ALPS touchpads have a middle button */
+    unsigned int multi:8;	/* Multi buttons 0-7, see HW_MULTI() */
 
-    Bool multi[8];
-    Bool middle;		/* Some ALPS touchpads have a middle button */
+    unsigned int new_coords:1;	/*If we want to restart mapping here*/
+    unsigned int new_eventset:1; /*False if we are in the middle of a partial update*/
 
-    SynapticsFinger *scroll_fingers[2];
+    SynapticsContacts contacts;
     SynapticsFinger *pressing_finger; /*Which finger is currently holding the mouse*/
+};
 
-    /*This is sorta like select(2)*/
-    Bool scroll_pass[SYNAPTICS_METRIC_COUNT][2]; /*By metric, by finger*/
-//    Bool scroll_pass_x[2];	/*Indexed by finger. Whether we updated X in this resultset*/
-//    Bool scroll_pass_y[2];	/*Same, but for Y*/
+#define HW_MULTI(hw, n) (((hw)->multi >> (n)) & 1)
 
-    Bool new_coords;	/*If we want to restart mapping here*/
-    Bool new_eventset;	/*False if we are in the middle of a partial update*/
-};
+/* Fails to compile when cond is false, for the layouts sized to cache lines */
+#define SYN_STATIC_ASSERT(name, cond) typedef char syn_static_assert_##name[(cond) ? 1 : -1]
+
+/* 64 bytes with 64 bit pointers, 60 with 32 bit ones */
+SYN_STATIC_ASSERT(hw_state_size,
+		  sizeof(struct SynapticsHwState) + 8 - sizeof(void *) == 64);
 
 struct CommData {
+    /* Used for keeping track of partial HwState updates. First, so that
+     * it sits on a cache line of its own. */
+    struct SynapticsHwState hwState;
+
     XISBuffer *buffer;
     unsigned char protoBuf[6];		/* Buffer for Packet */
     unsigned char lastByte;		/* Last read byte. Use for reset sequence detection. */
@@ -103,8 +147,6 @@ struct CommData {
 					   have received */
     int protoBufTail;
 
-    /* Used for keeping track of partial HwState updates. */
-    struct SynapticsHwState hwState;
     Bool oneFinger;
     Bool twoFingers;
     Bool threeFingers;
@@ -133,9 +175,10 @@ struct SynapticsProtocolOperations {
     void (*DeviceOffHook)(InputInfoPtr pInfo);
     void (*DeviceCloseHook)(DeviceIntPtr dev);
     Bool (*QueryHardware)(InputInfoPtr pInfo);
+    /* TRUE when a new complete frame was published in comm->hwState */
     Bool (*ReadHwState)(InputInfoPtr pInfo,
 			struct SynapticsProtocolOperations *proto_ops,
-			struct CommData *comm, struct SynapticsHwState *hwRet);
+			struct CommData *comm);
     Bool (*AutoDevProbe)(InputInfoPtr pInfo);
     void (*ReadDevDimensions)(InputInfoPtr pInfo);
 };
@@ -150,7 +193,10 @@ extern struct SynapticsProtocolOperations psm_proto_operations;
 extern struct SynapticsProtocolOperations alps_proto_operations;
 
 extern int HandleState(InputInfoPtr, struct SynapticsHwState*);
+extern void update_report_rate(InputInfoPtr pInfo, int millis, int nframes);
+extern void arm_timer(InputInfoPtr pInfo, int millis, int delay);
 extern CARD32 timerFunc(OsTimerPtr timer, CARD32 now, pointer arg);
 extern Bool is_inside_active_area(struct _SynapticsPrivateRec *priv, int x, int y);
+extern int get_button_zone(struct _SynapticsPrivateRec *priv, int x, int y);
 
 #endif /* _SYNPROTO_H_ */
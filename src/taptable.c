@@ -0,0 +1,100 @@
+#include "taptable.h"
+
+const struct TapTransition tap_table[TAP_STATES][TAP_ROWS] = {
+	[TS_START] = {
+		{ TI_TOUCH,		0, TA_NONE,		TS_1 },
+	},
+	[TS_1] = {
+		{ TI_MOVE,		0, TA_MOVE,		TS_MOVE,	TR_AGAIN },
+		{ TI_TIMEOUT,		0, TA_MOVE_FINGER,	TS_MOVE,	TR_AGAIN },
+		{ TI_RELEASE,		0, TA_SELECT,		TS_2A },
+	},
+	[TS_MOVE] = {
+		{ TI_MOVE,		0, TA_UNTRACK,		TS_MOVE },
+		{ TI_RELEASE,		0, TA_STOP,		TS_START },
+	},
+	[TS_2A] = {
+		{ TI_TOUCH,		0, TA_NONE,		TS_3 },
+		{ TI_TIMEOUT,		0, TA_NONE,		TS_SINGLETAP },
+	},
+	[TS_2B] = {
+		{ TI_TOUCH,		0, TA_NONE,		TS_3 },
+		{ TI_TIMEOUT,		0, TA_CLICK,		TS_START },
+	},
+	[TS_SINGLETAP] = {
+		{ TI_TOUCH,		0, TA_NONE,		TS_1 },
+		{ TI_TIMEOUT,		0, TA_NONE,		TS_START },
+	},
+	[TS_3] = {
+		{ TI_MOVE,		TC_TAP_AND_DRAG, TA_MOVE,	TS_DRAG,	TR_AGAIN },
+		{ TI_MOVE,		0, TA_NONE,		TS_1,		TR_AGAIN },
+		{ TI_TIMEOUT,		TC_TAP_AND_DRAG, TA_MOVE_FINGER, TS_DRAG,	TR_AGAIN },
+		{ TI_TIMEOUT,		0, TA_NONE,		TS_1,		TR_AGAIN },
+		{ TI_RELEASE,		0, TA_NONE,		TS_2B },
+	},
+	[TS_DRAG] = {
+		{ TI_MOVE,		0, TA_MOVE,		TS_DRAG },
+		{ TI_RELEASE,		TC_LOCKED_DRAGS, TA_STOP,	TS_4 },
+		{ TI_RELEASE,		0, TA_STOP,		TS_START },
+	},
+	[TS_4] = {
+		{ TI_TIMEOUT,		0, TA_NONE,		TS_START,	TR_AGAIN },
+		{ TI_TOUCH,		0, TA_NONE,		TS_5 },
+	},
+	[TS_5] = {
+		{ TI_TIMEOUT | TI_MOVE,	0, TA_NONE,		TS_DRAG,	TR_AGAIN },
+		{ TI_RELEASE,		0, TA_STOP,		TS_START },
+	},
+};
+
+/*
+ * The tap button on entering a state. States not listed keep the button
+ * as it was, so a drag holds the button the second touch pressed.
+ */
+enum TapButtonState tap_enter(enum TapState next, enum TapButtonState button,
+		int conds)
+{
+	switch (next) {
+	case TS_START:
+	case TS_1:
+	case TS_2B:
+		return TBS_BUTTON_UP;
+	case TS_2A:
+		return (conds & TC_FAST_TAPS) ? TBS_BUTTON_DOWN : TBS_BUTTON_UP;
+	case TS_3:
+		return (conds & TC_TAP_AND_DRAG) ? TBS_BUTTON_DOWN : TBS_BUTTON_UP;
+	case TS_SINGLETAP:
+		return (conds & TC_FAST_TAPS) ? TBS_BUTTON_UP : TBS_BUTTON_DOWN;
+	default:
+		return button;
+	}
+}
+
+/*
+ * Hand one frame's events to the rows of the current state, following
+ * TR_AGAIN rows until a row without it is taken or nothing matches.
+ */
+void tap_step(enum TapState *state, enum TapButtonState *button, int events,
+		int conds, tap_action_func act, void *data)
+{
+	const struct TapTransition *t;
+	enum TapState from;
+
+	for (t = tap_table[*state]; t->events; ) {
+		if (!(t->events & events) || (t->cond & ~conds)) {
+			t++;
+			continue;
+		}
+		from = *state;
+		if (t->next != from) {
+			*button = tap_enter(t->next, *button, conds);
+			*state = t->next;
+		}
+		if (t->action == TA_CLICK)
+			*button = TBS_BUTTON_DOWN_UP;
+		act(data, from, t);
+		if (!t->again)
+			break;
+		t = tap_table[*state];
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef TAPTABLE_H
+#define TAPTABLE_H
+
+/*
+ * The tap and drag state machine (see docs/tapndrag.dia) as a table. Every
+ * frame is reduced to a set of events; the rows of the current state are
+ * tried in order and the first one matching one of the events, and whose
+ * parameter condition holds, makes the transition. Rows marked TR_AGAIN
+ * hand the same events to the next state right away.
+ *
+ * Nothing here depends on the server, so test/testtaptable.c runs the
+ * table on its own.
+ */
+
+enum TapState {
+	TS_START,		/* No tap/drag in progress */
+	TS_1,			/* After first touch */
+	TS_MOVE,		/* Pointer movement enabled */
+	TS_2A,			/* After first release */
+	TS_2B,			/* After second/third/... release */
+	TS_SINGLETAP,		/* After timeout after first release */
+	TS_3,			/* After second touch */
+	TS_DRAG,		/* Pointer drag enabled */
+	TS_4,			/* After release when "locked drags" enabled */
+	TS_5			/* After touch when "locked drags" enabled */
+};
+
+enum TapButtonState {
+	TBS_BUTTON_UP,		/* "Virtual tap button" is up */
+	TBS_BUTTON_DOWN,	/* "Virtual tap button" is down */
+	TBS_BUTTON_DOWN_UP	/* Send button down event + set up state */
+};
+
+enum TapInput {
+	TI_TOUCH = 1 << 0,	/* finger put down */
+	TI_RELEASE = 1 << 1,	/* finger lifted */
+	TI_MOVE = 1 << 2,	/* moved further than tap_move */
+	TI_TIMEOUT = 1 << 3	/* the deadline of the state has passed */
+};
+
+enum TapCondition {
+	TC_TAP_AND_DRAG = 1 << 0,	/* tap_and_drag_gesture is set */
+	TC_LOCKED_DRAGS = 1 << 1,	/* locked_drags is set */
+	TC_FAST_TAPS = 1 << 2		/* fast_taps is set */
+};
+
+enum TapAction {
+	TA_NONE,
+	TA_MOVE,		/* pointer moves relative */
+	TA_UNTRACK,		/* trackstick mode ends, pointer moves relative */
+	TA_MOVE_FINGER,		/* pointer moves as the finger state says */
+	TA_STOP,		/* pointer motion ends */
+	TA_SELECT,		/* pick the tap button */
+	TA_CLICK		/* send the pending tap as a click */
+};
+
+#define TR_AGAIN 1
+#define TAP_STATES (TS_5 + 1)
+#define TAP_ROWS 5
+
+struct TapTransition {
+	unsigned char events;	/* enum TapInput mask, 0 ends the rows */
+	unsigned char cond;	/* enum TapCondition mask that must hold */
+	unsigned char action;
+	unsigned char next;
+	unsigned char again;
+};
+
+/* called for every row taken, after state and button have been updated */
+typedef void (*tap_action_func)(void *data, enum TapState from,
+		const struct TapTransition *t);
+
+extern const struct TapTransition tap_table[TAP_STATES][TAP_ROWS];
+
+enum TapButtonState tap_enter(enum TapState next, enum TapButtonState button,
+		int conds);
+void tap_step(enum TapState *state, enum TapButtonState *button, int events,
+		int conds, tap_action_func act, void *data);
+
+#endif /*TAPTABLE_H*/
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
 #include "yolog.h"
 
@@ -24,6 +25,8 @@
 #define _GREEN "2"
 #define _RED "1"
 #define _BLACK "0"
+/*Longest message, anything beyond is cut*/
+#define YOLOG_LINE_MAX 512
 /*Logging subsystem*/
 
 #define __loggerlogwrap(level, fmt, ...) yobot_logger(loggerparams_internal, level, \
@@ -78,6 +81,52 @@ static void _init_color_logging(void) {
 static int use_escapes = 0;
 #endif
 
+int yolog_ratelimit_pass(yolog_ratelimit *rl, unsigned long *suppressed) {
+	struct timespec ts;
+
+	/*clock_gettime is safe in a signal handler, gettimeofday is not*/
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return yolog_ratelimit_take(rl, (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000,
+			suppressed);
+}
+
+int yolog_ratelimit_take(yolog_ratelimit *rl, long long now, unsigned long *suppressed) {
+	if (!rl->started) {
+		rl->started = 1;
+		rl->tokens = YOLOG_RL_BURST;
+		rl->refilled = now;
+	} else if (rl->tokens == YOLOG_RL_BURST) {
+		rl->refilled = now;
+	} else {
+		long long earned = (now - rl->refilled) / YOLOG_RL_PERIOD;
+
+		if (earned > 0) {
+			rl->tokens = earned >= YOLOG_RL_BURST - rl->tokens ?
+				YOLOG_RL_BURST : rl->tokens + earned;
+			rl->refilled += earned * YOLOG_RL_PERIOD;
+		}
+	}
+
+	if (rl->tokens == 0) {
+		rl->suppressed++;
+		return 0;
+	}
+	rl->tokens--;
+	*suppressed = rl->suppressed;
+	rl->suppressed = 0;
+	return 1;
+}
+
+void yobot_log_init(void) {
+	if(use_escapes < 0) {
+		_init_color_logging();
+	}
+}
+
+/*
+ * Messages come from the SIGIO handler too, so they are formatted on the
+ * stack and written in one go: no stdio locks, no allocation.
+ */
 void yobot_logger(yobot_log_s logparams, yobot_log_level level, int line,
 		const char *fn, const char *fmt, ...) {
 	if (logparams.level > level) {
@@ -88,6 +137,8 @@ void yobot_logger(yobot_log_s logparams, yobot_log_level level, int line,
 	}
 	va_list ap;
 	va_start(ap, fmt);
+	char buf[YOLOG_LINE_MAX];
+	int len = 0;
 	char *line_fmt = "";
 	if (use_escapes) {
 		switch (level) {
@@ -109,17 +160,23 @@ void yobot_logger(yobot_log_s logparams, yobot_log_level level, int line,
 			break;
 		}
 	}
-	flockfile(stderr);
-	fprintf(stderr, "[%s%s%s] ", title_fmt, logparams.prefix, reset_fmt);
+#define _append(f, ...) \
+	if (len < (int)sizeof(buf)) \
+		len += f(buf + len, sizeof(buf) - len, __VA_ARGS__)
+	_append(snprintf, "[%s%s%s] ", title_fmt, logparams.prefix, reset_fmt);
 #ifdef YOLOG_TIME
-	fprintf(stderr, " %f ", (float)clock()/CLOCKS_PER_SEC);
+	_append(snprintf, " %f ", (float)clock()/CLOCKS_PER_SEC);
 #endif
-	fprintf(stderr, "%s", line_fmt);
-	fprintf(stderr, "%s:%d ", fn, line);
-	vfprintf(stderr, fmt, ap);
-	fprintf(stderr, "%s", reset_fmt);
-	fprintf(stderr, "\n");
-	fflush(NULL);
-	funlockfile(stderr);
+	_append(snprintf, "%s%s:%d ", line_fmt, fn, line);
+	_append(vsnprintf, fmt, ap);
+#undef _append
 	va_end(ap);
+
+	/*Keep the reset and the newline even if the message was cut*/
+	if (len > (int)sizeof(buf) - 16)
+		len = sizeof(buf) - 16;
+	len += snprintf(buf + len, sizeof(buf) - len, "%s\n", reset_fmt);
+	if (write(STDERR_FILENO, buf, len) < 0) {
+		/*Nowhere left to complain*/
+	}
 }
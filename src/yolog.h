@@ -39,9 +39,42 @@ extern yobot_log_s yobotproto_log_params;
 	};
 #endif
 
+/*
+ * Token bucket behind every logging call site: a site may log a burst of
+ * YOLOG_RL_BURST messages, then earns one back every YOLOG_RL_PERIOD ms.
+ * What it drops is counted and summarised with its next message, so a
+ * message firing on every frame costs one line a second.
+ */
+#define YOLOG_RL_BURST 10
+#define YOLOG_RL_PERIOD 1000
+
+typedef struct {
+	int started;
+	int tokens;
+	long long refilled;	/*ms of the last refill*/
+	unsigned long suppressed;
+} yolog_ratelimit;
+
+/*Whether the site may log now; *suppressed gets what it dropped since*/
+int yolog_ratelimit_pass(yolog_ratelimit *rl, unsigned long *suppressed);
+/*The same at now, ms on a monotonic clock*/
+int yolog_ratelimit_take(yolog_ratelimit *rl, long long now, unsigned long *suppressed);
+
+/*Looks at the terminal once; call before logging from a signal handler*/
+void yobot_log_init(void);
 void yobot_logger(yobot_log_s logparams, yobot_log_level level, int line, const char *fn, const char *fmt, ...);
 
-#define __logwrap(level, fmt, ...) yobot_logger(YOLOG_PRIV_NAME, level, __LINE__, __func__, fmt, ## __VA_ARGS__)
+#define __logwrap(lvl, fmt, ...) do { \
+	static yolog_ratelimit __rl; \
+	unsigned long __suppressed; \
+	if (YOLOG_PRIV_NAME.level <= (lvl) && \
+	    yolog_ratelimit_pass(&__rl, &__suppressed)) { \
+		if (__suppressed) \
+			yobot_logger(YOLOG_PRIV_NAME, lvl, __LINE__, __func__, \
+				"%lu messages suppressed", __suppressed); \
+		yobot_logger(YOLOG_PRIV_NAME, lvl, __LINE__, __func__, fmt, ## __VA_ARGS__); \
+	} \
+} while (0)
 
 #define yolog_info(fmt, ...) __logwrap(YOBOT_LOG_INFO, fmt, ## __VA_ARGS__)
 #define yolog_debug(fmt, ...) __logwrap(YOBOT_LOG_DEBUG, fmt, ## __VA_ARGS__)
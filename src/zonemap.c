@@ -0,0 +1,229 @@
+#include "zonemap.h"
+
+#ifndef M_SQRT1_2
+#define M_SQRT1_2  0.70710678118654752440  /* 1/sqrt(2) */
+#endif
+
+#define SQR(x) ((x) * (x))
+#define MAX(a, b) (((a)>(b))?(a):(b))
+
+/*
+ * Convert from absolute X/Y coordinates to a coordinate system where
+ * -1 corresponds to the left/upper edge and +1 corresponds to the
+ * right/lower edge.
+ */
+void zone_relative(const ZoneMap *z, int x, int y, double *rx, double *ry)
+{
+	*rx = (x - z->center_x) * z->inv_half_x;
+	*ry = (y - z->center_y) * z->inv_half_y;
+}
+
+static int
+circular_edges(const ZoneMap *z, int x, int y)
+{
+	int edge = 0;
+	double rx, ry;
+
+	zone_relative(z, x, y, &rx, &ry);
+
+	if (SQR(rx) + SQR(ry) > 1) {
+		/* we are outside the ellipse enclosed by the edges */
+		if (rx > M_SQRT1_2)
+			edge |= ZONE_RIGHT_EDGE;
+		else if (rx < -M_SQRT1_2)
+			edge |= ZONE_LEFT_EDGE;
+
+		if (ry < -M_SQRT1_2)
+			edge |= ZONE_TOP_EDGE;
+		else if (ry > M_SQRT1_2)
+			edge |= ZONE_BOTTOM_EDGE;
+	}
+	return edge;
+}
+
+int zone_edges_exact(const ZoneMap *z, int x, int y)
+{
+	int edge = 0;
+
+	if (z->circular)
+		return circular_edges(z, x, y);
+
+	if (x > z->right_edge)
+		edge |= ZONE_RIGHT_EDGE;
+	else if (x < z->left_edge)
+		edge |= ZONE_LEFT_EDGE;
+
+	if (y < z->top_edge)
+		edge |= ZONE_TOP_EDGE;
+	else if (y > z->bottom_edge)
+		edge |= ZONE_BOTTOM_EDGE;
+
+	return edge;
+}
+
+/* whether x/y is in the active area, always if no edge of it is set */
+int zone_active_exact(const ZoneMap *z, int x, int y)
+{
+	if ((z->area_left_edge != 0 && x < z->area_left_edge) ||
+	    (z->area_right_edge != 0 && x > z->area_right_edge))
+		return 0;
+	if ((z->area_top_edge != 0 && y < z->area_top_edge) ||
+	    (z->area_bottom_edge != 0 && y > z->area_bottom_edge))
+		return 0;
+	return 1;
+}
+
+/*
+ * The button a click at x/y maps to: 3 or 2 inside the right or middle
+ * area, 1 elsewhere in the band the areas lie in and 0 above that band or
+ * if no areas are set up.
+ */
+int zone_button_exact(const ZoneMap *z, int x, int y)
+{
+	static const int buttons[ZONE_BUTTON_AREAS] = { 3, 2 };
+	int i;
+
+	if (y < z->button_band_top)
+		return 0;
+
+	for (i = 0; i < ZONE_BUTTON_AREAS; i++) {
+		const int *zone = z->button_zone[i];
+
+		if (x >= zone[0] && x <= zone[1] && y >= zone[2] && y <= zone[3])
+			return buttons[i];
+	}
+	return 1;
+}
+
+/* log2 of the cell size that fits range into ZONE_GRID cells */
+static int
+cell_shift(int range)
+{
+	int shift = 0;
+
+	while ((range >> shift) >= ZONE_GRID)
+		shift++;
+	return shift;
+}
+
+/* whether v lies in lo..hi, i.e. a boundary at v may split the cell */
+static int
+in_cell(int lo, int hi, int v)
+{
+	return v >= lo && v <= hi;
+}
+
+/* whether circular_edges() can differ within the cell */
+static int
+circular_edge_splits(const ZoneMap *z, int x0, int x1, int y0, int y1)
+{
+	double rx0, ry0, rx1, ry1, nx, ny;
+
+	zone_relative(z, x0, y0, &rx0, &ry0);
+	zone_relative(z, x1, y1, &rx1, &ry1);
+
+	if ((rx0 <= M_SQRT1_2 && rx1 > M_SQRT1_2) || (rx0 < -M_SQRT1_2 && rx1 >= -M_SQRT1_2) ||
+	    (ry0 <= M_SQRT1_2 && ry1 > M_SQRT1_2) || (ry0 < -M_SQRT1_2 && ry1 >= -M_SQRT1_2))
+		return 1;
+
+	/* the ellipse crosses the cell if its nearest point to the center is
+	 * inside and its farthest one outside */
+	nx = (rx0 > 0) ? rx0 : (rx1 < 0) ? rx1 : 0;
+	ny = (ry0 > 0) ? ry0 : (ry1 < 0) ? ry1 : 0;
+	return SQR(nx) + SQR(ny) <= 1 &&
+	       MAX(SQR(rx0), SQR(rx1)) + MAX(SQR(ry0), SQR(ry1)) > 1;
+}
+
+/*
+ * Fill the map over minx..maxx, miny..maxy. The range is cut into at most
+ * ZONE_GRID x ZONE_GRID cells of a power of two size, each holding the
+ * edges, the active area flag and the button zone of its first point.
+ */
+void zone_map_build(ZoneMap *z, int minx, int maxx, int miny, int maxy)
+{
+	int row, col, i;
+
+	z->x0 = minx;
+	z->y0 = miny;
+	z->shift_x = cell_shift(MAX(maxx - minx, 0));
+	z->shift_y = cell_shift(MAX(maxy - miny, 0));
+
+	for (row = 0; row < ZONE_GRID; row++) {
+		int y0 = z->y0 + (row << z->shift_y);
+		int y1 = y0 + (1 << z->shift_y) - 1;
+
+		for (col = 0; col < ZONE_GRID; col++) {
+			int x0 = z->x0 + (col << z->shift_x);
+			int x1 = x0 + (1 << z->shift_x) - 1;
+			unsigned short cell;
+
+			cell = zone_edges_exact(z, x0, y0);
+			if (zone_active_exact(z, x0, y0))
+				cell |= ZONE_CELL_ACTIVE;
+			cell |= zone_button_exact(z, x0, y0) << ZONE_CELL_BUTTON_SHIFT;
+
+			if (z->circular ?
+			    circular_edge_splits(z, x0, x1, y0, y1) :
+			    (in_cell(x0, x1, z->left_edge) || in_cell(x0, x1, z->right_edge) ||
+			     in_cell(y0, y1, z->top_edge) || in_cell(y0, y1, z->bottom_edge)))
+				cell |= ZONE_CELL_EXACT_EDGE;
+
+			if (in_cell(x0, x1, z->area_left_edge) || in_cell(x0, x1, z->area_right_edge) ||
+			    in_cell(y0, y1, z->area_top_edge) || in_cell(y0, y1, z->area_bottom_edge))
+				cell |= ZONE_CELL_EXACT_ACTIVE;
+
+			if (in_cell(y0, y1, z->button_band_top))
+				cell |= ZONE_CELL_EXACT_BUTTON;
+			for (i = 0; i < ZONE_BUTTON_AREAS; i++) {
+				const int *zone = z->button_zone[i];
+
+				if (in_cell(x0, x1, zone[0]) || in_cell(x0, x1, zone[1]) ||
+				    in_cell(y0, y1, zone[2]) || in_cell(y0, y1, zone[3]))
+					cell |= ZONE_CELL_EXACT_BUTTON;
+			}
+
+			z->map[row][col] = cell;
+		}
+	}
+}
+
+/* the map cell of x/y, all ZONE_CELL_EXACT flags outside the map */
+unsigned int zone_cell(const ZoneMap *z, int x, int y)
+{
+	unsigned int col = (unsigned int)(x - z->x0) >> z->shift_x;
+	unsigned int row = (unsigned int)(y - z->y0) >> z->shift_y;
+
+	if (col >= ZONE_GRID || row >= ZONE_GRID)
+		return ZONE_CELL_EXACT;
+	return z->map[row][col];
+}
+
+/* the edges x/y is beyond, as zone_edges_exact() */
+int zone_edges(const ZoneMap *z, int x, int y)
+{
+	unsigned int cell = zone_cell(z, x, y);
+
+	if (cell & ZONE_CELL_EXACT_EDGE)
+		return zone_edges_exact(z, x, y);
+	return cell & ZONE_CELL_EDGE_MASK;
+}
+
+/* whether x/y is in the active area, as zone_active_exact() */
+int zone_active(const ZoneMap *z, int x, int y)
+{
+	unsigned int cell = zone_cell(z, x, y);
+
+	if (cell & ZONE_CELL_EXACT_ACTIVE)
+		return zone_active_exact(z, x, y);
+	return (cell & ZONE_CELL_ACTIVE) != 0;
+}
+
+/* the button of a click at x/y, as zone_button_exact() */
+int zone_button(const ZoneMap *z, int x, int y)
+{
+	unsigned int cell = zone_cell(z, x, y);
+
+	if (cell & ZONE_CELL_EXACT_BUTTON)
+		return zone_button_exact(z, x, y);
+	return (cell & ZONE_CELL_BUTTON_MASK) >> ZONE_CELL_BUTTON_SHIFT;
+}
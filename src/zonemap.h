@@ -0,0 +1,65 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+/*
+ * The pad zones, i.e. the edges, the active area and the clickpad soft
+ * button areas, over a coarse map of the device range. The caller fills
+ * in the bounds and zone_map_build() the map; each cell holds the zones
+ * that hold for all of it, and cells a boundary runs through are flagged
+ * so the lookup falls back to the exact test there.
+ */
+
+#define ZONE_GRID 32		/* map cells per axis, a power of two */
+#define ZONE_BUTTON_AREAS 2	/* right and middle soft button area */
+
+/* edge bits, the values of edge_type in synaptics.c */
+#define ZONE_BOTTOM_EDGE 1
+#define ZONE_TOP_EDGE 2
+#define ZONE_LEFT_EDGE 4
+#define ZONE_RIGHT_EDGE 8
+
+/* map cell */
+#define ZONE_CELL_EDGE_MASK	0x000f	/* edge bits of the cell */
+#define ZONE_CELL_ACTIVE	0x0010	/* inside the active area */
+#define ZONE_CELL_BUTTON_SHIFT	5	/* zone_button() value of the cell */
+#define ZONE_CELL_BUTTON_MASK	(3 << ZONE_CELL_BUTTON_SHIFT)
+#define ZONE_CELL_EXACT_EDGE	0x0080	/* an edge runs through the cell */
+#define ZONE_CELL_EXACT_ACTIVE	0x0100	/* the active area boundary runs through the cell */
+#define ZONE_CELL_EXACT_BUTTON	0x0200	/* a button zone boundary runs through the cell */
+#define ZONE_CELL_EXACT \
+	(ZONE_CELL_EXACT_EDGE | ZONE_CELL_EXACT_ACTIVE | ZONE_CELL_EXACT_BUTTON)
+
+typedef struct {
+	/* edges, an ellipse through their midpoints on a circular pad */
+	int left_edge, right_edge, top_edge, bottom_edge;
+	int circular;
+	double center_x, center_y;	/* center of the edges */
+	double inv_half_x, inv_half_y;	/* 1 / half the pad width and height, 0 if degenerate */
+
+	/* active area, an edge of 0 is open */
+	int area_left_edge, area_right_edge, area_top_edge, area_bottom_edge;
+
+	/* soft button areas: left, right, top, bottom, INT_MIN/INT_MAX for
+	 * open edges; an area that is off has empty bounds */
+	int button_zone[ZONE_BUTTON_AREAS][4];
+	int button_band_top;		/* top of the band holding the areas, INT_MAX if none */
+
+	/* filled by zone_map_build() */
+	unsigned short map[ZONE_GRID][ZONE_GRID];	/* cells by row, column */
+	int x0, y0;			/* device coordinates of the first cell */
+	int shift_x, shift_y;		/* log2 of the cell size */
+} ZoneMap;
+
+void zone_map_build(ZoneMap *z, int minx, int maxx, int miny, int maxy);
+void zone_relative(const ZoneMap *z, int x, int y, double *rx, double *ry);
+unsigned int zone_cell(const ZoneMap *z, int x, int y);
+
+int zone_edges(const ZoneMap *z, int x, int y);
+int zone_active(const ZoneMap *z, int x, int y);
+int zone_button(const ZoneMap *z, int x, int y);
+
+int zone_edges_exact(const ZoneMap *z, int x, int y);
+int zone_active_exact(const ZoneMap *z, int x, int y);
+int zone_button_exact(const ZoneMap *z, int x, int y);
+
+#endif /*ZONEMAP_H*/
@@ -0,0 +1,57 @@
+/*
+ * A stand-in for libutouch-grail, so replay.c also runs the driver's grail
+ * input path (GrailGestures on): grail_pull() reads the device and hands
+ * every event to the driver's event callback, the way the library does, but
+ * recognises no gestures. What the real library does with the events is
+ * not under test here.
+ */
+#include <xorg-server.h>
+#include <scrnintstr.h>
+#include <grail.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+/* GrailOpen() sizes the gesture bounding box from the first screen */
+static ScreenRec screen = { .width = 1024, .height = 768 };
+ScreenInfo screenInfo = { .numScreens = 1, .screens = { &screen } };
+
+int
+grail_open(struct grail *ge, int fd)
+{
+    return 0;
+}
+
+void
+grail_close(struct grail *ge, int fd)
+{
+}
+
+void
+grail_set_bbox(struct grail *ge, const struct grail_coord *min,
+	       const struct grail_coord *max)
+{
+}
+
+void
+grail_mask_clear(grail_mask_t *mask, int bytes)
+{
+    memset(mask, 0, bytes);
+}
+
+int
+grail_pull(struct grail *ge, int fd)
+{
+    struct input_event ev;
+    int count = 0;
+
+    while (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+	ge->event(ge, &ev);
+	count++;
+    }
+    if (count)
+	return count;
+    return errno == EAGAIN ? 0 : -1;
+}
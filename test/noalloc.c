@@ -0,0 +1,224 @@
+/*
+ * Link time interposer for replay.c: linked with --wrap for each function
+ * below, every call the driver makes to the allocator or to stdio streams
+ * comes through here and aborts while checking is on. That is what may not
+ * happen in the SIGIO handler. Formatting into a buffer (snprintf) is
+ * left alone.
+ *
+ *   -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free,--wrap=strdup
+ *   -Wl,--wrap=printf,--wrap=fprintf,--wrap=vprintf,--wrap=vfprintf
+ *   -Wl,--wrap=puts,--wrap=fputs,--wrap=fputc,--wrap=putchar,--wrap=fwrite
+ *   -Wl,--wrap=fflush,--wrap=perror,--wrap=__printf_chk,--wrap=__fprintf_chk
+ *   -Wl,--wrap=__vprintf_chk,--wrap=__vfprintf_chk
+ *
+ * The __*_chk functions are what printf and friends compile to with
+ * _FORTIFY_SOURCE.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "noalloc.h"
+
+static int checking;
+
+void
+noalloc_check(int on)
+{
+    checking = on;
+}
+
+static void
+forbidden(const char *what)
+{
+    static const char msg[] = " called while replaying frames\n";
+
+    if (!checking)
+	return;
+    checking = 0;
+    if (write(STDERR_FILENO, what, strlen(what)) < 0 ||
+	write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0)
+	_exit(2);
+    abort();
+}
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+char *__real_strdup(const char *s);
+int __real_vfprintf(FILE *stream, const char *format, va_list ap);
+int __real_fputs(const char *s, FILE *stream);
+int __real_fputc(int c, FILE *stream);
+size_t __real_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream);
+int __real_fflush(FILE *stream);
+void __real_perror(const char *s);
+int __real___vfprintf_chk(FILE *stream, int flag, const char *format, va_list ap);
+
+void *
+__wrap_malloc(size_t size)
+{
+    forbidden("malloc");
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+    forbidden("calloc");
+    return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+    forbidden("realloc");
+    return __real_realloc(ptr, size);
+}
+
+void
+__wrap_free(void *ptr)
+{
+    forbidden("free");
+    __real_free(ptr);
+}
+
+char *
+__wrap_strdup(const char *s)
+{
+    forbidden("strdup");
+    return __real_strdup(s);
+}
+
+int
+__wrap_vfprintf(FILE *stream, const char *format, va_list ap)
+{
+    forbidden("vfprintf");
+    return __real_vfprintf(stream, format, ap);
+}
+
+int
+__wrap_vprintf(const char *format, va_list ap)
+{
+    forbidden("vprintf");
+    return __real_vfprintf(stdout, format, ap);
+}
+
+int
+__wrap_fprintf(FILE *stream, const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    forbidden("fprintf");
+    va_start(ap, format);
+    n = __real_vfprintf(stream, format, ap);
+    va_end(ap);
+    return n;
+}
+
+int
+__wrap_printf(const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    forbidden("printf");
+    va_start(ap, format);
+    n = __real_vfprintf(stdout, format, ap);
+    va_end(ap);
+    return n;
+}
+
+int
+__wrap_fputs(const char *s, FILE *stream)
+{
+    forbidden("fputs");
+    return __real_fputs(s, stream);
+}
+
+int
+__wrap_puts(const char *s)
+{
+    forbidden("puts");
+    if (__real_fputs(s, stdout) < 0)
+	return EOF;
+    return __real_fputc('\n', stdout);
+}
+
+int
+__wrap_fputc(int c, FILE *stream)
+{
+    forbidden("fputc");
+    return __real_fputc(c, stream);
+}
+
+int
+__wrap_putchar(int c)
+{
+    forbidden("putchar");
+    return __real_fputc(c, stdout);
+}
+
+size_t
+__wrap_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+    forbidden("fwrite");
+    return __real_fwrite(ptr, size, nmemb, stream);
+}
+
+int
+__wrap_fflush(FILE *stream)
+{
+    forbidden("fflush");
+    return __real_fflush(stream);
+}
+
+void
+__wrap_perror(const char *s)
+{
+    forbidden("perror");
+    __real_perror(s);
+}
+
+int
+__wrap___vfprintf_chk(FILE *stream, int flag, const char *format, va_list ap)
+{
+    forbidden("vfprintf");
+    return __real___vfprintf_chk(stream, flag, format, ap);
+}
+
+int
+__wrap___vprintf_chk(int flag, const char *format, va_list ap)
+{
+    forbidden("vprintf");
+    return __real___vfprintf_chk(stdout, flag, format, ap);
+}
+
+int
+__wrap___fprintf_chk(FILE *stream, int flag, const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    forbidden("fprintf");
+    va_start(ap, format);
+    n = __real___vfprintf_chk(stream, flag, format, ap);
+    va_end(ap);
+    return n;
+}
+
+int
+__wrap___printf_chk(int flag, const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    forbidden("printf");
+    va_start(ap, format);
+    n = __real___vfprintf_chk(stdout, flag, format, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,7 @@
+#ifndef NOALLOC_H
+#define NOALLOC_H
+
+/* abort on allocation or stdio from now on (1) or not (0) */
+void noalloc_check(int on);
+
+#endif /*NOALLOC_H*/
@@ -0,0 +1,500 @@
+/*
+ * Replays recorded evdev traces through the driver and aborts if anything
+ * allocates or writes to a stdio stream from the first replayed frame to
+ * the last, timer wakeups included. The device is brought up the way the
+ * server does it, through PreInit, DEVICE_INIT and DEVICE_ON, with the
+ * trace's description answering the evdev ioctls.
+ *
+ * Without arguments, as run by make check, every fixture below is replayed
+ * from $srcdir and the events the driver posts are checked against the
+ * counts expected for it. Each trace is replayed with grail off and on;
+ * see grailstubs.c for what stands in for the library.
+ *
+ * pointer.evemu is also replayed with pointer prediction on, which has to
+ * bring the pointer closer to the finger than no prediction, by the
+ * driver's own bookkeeping (predict_check()), and has to end where the
+ * pointer ends without it.
+ *
+ * scroll.evemu also has to post its first scroll step within
+ * SCROLL_ONSET_LIMIT of the two fingers starting to move, rather than after
+ * the samples the driver used to wait for.
+ *
+ * With a trace recorded by evemu-record, and options to set on the device,
+ * the counts for that trace are printed instead:
+ *
+ *   ./replay trackpad.evemu TapButton1=0 PalmDetect=on
+ */
+#include <xorg-server.h>
+#include <xf86.h>
+#include <xf86Xinput.h>
+#include <xf86Module.h>
+#include <inputstr.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "synapticsstr.h"
+#include "noalloc.h"
+#include "xstubs.h"
+
+#define REPLAY_START 1000	/* GetTimeInMillis() at the first event */
+#define REPLAY_TAIL 1000	/* how long timers keep running after the last event */
+
+struct Counts {
+    int frames;
+    int motion;		/* motion events */
+    int dx, dy;		/* where the relative motion took the pointer */
+    int scrolls;	/* scroll steps */
+    int presses;	/* key presses and presses of buttons other than the scroll buttons */
+    int touches;	/* touch events */
+};
+
+/* pointer prediction against none, in device units */
+struct Prediction {
+    int checked;	/* predictions checked */
+    double rms;		/* error of the predicted position */
+    double base_rms;	/* error of the position without prediction */
+};
+
+#define PREDICT_TRACE "pointer.evemu"
+#define PREDICT_OPTION "PredictionHorizon=20"
+#define PREDICT_END_SLACK 2	/* device units the lead may be off in the end */
+
+#define SCROLL_ONSET_TRACE "scroll.evemu"
+#define SCROLL_ONSET_LIMIT 40	/* ms from the fingers moving to the first scroll step */
+#define SCROLL_SLOTS 16
+
+struct Fixture {
+    const char *trace;
+    const char *options[4];	/* "Name=value", also set on the grail run */
+    struct Counts expect;
+};
+
+static const struct Fixture fixtures[] = {
+    { "pointer.evemu", { NULL }, { 75, 42, 770, 1620, 0, 3, 75 } },
+    /* every contact a palm from its first report, only the click is left */
+    { "pointer.evemu", { "PalmDetect=on", "PalmMinTouchMajor=10%", NULL },
+      { 75, 0, 0, 0, 0, 1, 75 } },
+    { "scroll.evemu", { NULL }, { 40, 0, 0, 0, 8, 0, 105 } },
+};
+
+extern XF86ModuleData synaptics2ModuleData;
+
+/* the device as evemu-record describes it */
+static char dev_name[256];
+static struct input_id dev_id;
+static unsigned char dev_props[INPUT_PROP_CNT / 8];
+static unsigned char dev_bits[EV_CNT][KEY_CNT / 8];
+static int dev_nbits[EV_CNT];
+static struct input_absinfo dev_abs[ABS_CNT];
+
+static struct input_event *events;
+static int nevents;
+static int *frame_end;		/* one past the last event of each frame */
+static int nframes;
+
+static void
+fail(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    exit(1);
+}
+
+static void
+add_bits(unsigned char *bits, int *nbits, int size, const char *str)
+{
+    unsigned int byte;
+    int n;
+
+    while (sscanf(str, " %x%n", &byte, &n) == 1) {
+	if (*nbits < size)
+	    bits[(*nbits)++] = byte;
+	str += n;
+    }
+}
+
+static void
+read_trace(const char *path)
+{
+    char line[512];
+    int size = 0, nprops = 0;
+    FILE *f;
+
+    memset(dev_name, 0, sizeof(dev_name));
+    memset(&dev_id, 0, sizeof(dev_id));
+    memset(dev_props, 0, sizeof(dev_props));
+    memset(dev_bits, 0, sizeof(dev_bits));
+    memset(dev_nbits, 0, sizeof(dev_nbits));
+    memset(dev_abs, 0, sizeof(dev_abs));
+    free(events);
+    free(frame_end);
+    events = NULL;
+    frame_end = NULL;
+    nevents = nframes = 0;
+
+    f = fopen(path, "r");
+    if (!f)
+	fail("%s: %s\n", path, strerror(errno));
+
+    while (fgets(line, sizeof(line), f)) {
+	unsigned long sec, usec;
+	unsigned int type, code;
+	int value, n;
+	struct input_absinfo abs = { 0 };
+
+	if (!strncmp(line, "N: ", 3)) {
+	    line[strcspn(line, "\n")] = '\0';
+	    snprintf(dev_name, sizeof(dev_name), "%.*s",
+		     (int)sizeof(dev_name) - 1, line + 3);
+	} else if (!strncmp(line, "I: ", 3)) {
+	    unsigned int bus, vendor, product, version;
+
+	    if (sscanf(line + 3, "%x %x %x %x", &bus, &vendor, &product, &version) == 4) {
+		dev_id.bustype = bus;
+		dev_id.vendor = vendor;
+		dev_id.product = product;
+		dev_id.version = version;
+	    }
+	} else if (!strncmp(line, "P: ", 3)) {
+	    add_bits(dev_props, &nprops, sizeof(dev_props), line + 3);
+	} else if (!strncmp(line, "B: ", 3)) {
+	    if (sscanf(line + 3, "%x%n", &type, &n) == 1 && type < EV_CNT)
+		add_bits(dev_bits[type], &dev_nbits[type], sizeof(dev_bits[type]),
+			 line + 3 + n);
+	} else if (!strncmp(line, "A: ", 3)) {
+	    if (sscanf(line + 3, "%x %d %d %d %d %d", &code, &abs.minimum,
+		       &abs.maximum, &abs.fuzz, &abs.flat, &abs.resolution) >= 5 &&
+		code < ABS_CNT)
+		dev_abs[code] = abs;
+	} else if (!strncmp(line, "E: ", 3)) {
+	    if (sscanf(line + 3, "%lu.%lu %x %x %d", &sec, &usec, &type, &code,
+		       &value) != 5)
+		continue;
+	    if (nevents == size) {
+		size = size ? 2 * size : 4096;
+		events = realloc(events, size * sizeof(*events));
+		frame_end = realloc(frame_end, size * sizeof(*frame_end));
+		if (!events || !frame_end)
+		    fail("out of memory\n");
+	    }
+	    events[nevents].time.tv_sec = sec;
+	    events[nevents].time.tv_usec = usec;
+	    events[nevents].type = type;
+	    events[nevents].code = code;
+	    events[nevents].value = value;
+	    nevents++;
+	    if (type == EV_SYN && code == SYN_REPORT)
+		frame_end[nframes++] = nevents;
+	}
+    }
+    fclose(f);
+
+    if (!nframes)
+	fail("%s: no frames\n", path);
+}
+
+/* evdev ioctls on the replayed device come from the trace */
+int __real_ioctl(int fd, unsigned long request, ...);
+
+int
+__wrap_ioctl(int fd, unsigned long request, ...)
+{
+    unsigned int nr = _IOC_NR(request);
+    unsigned int size = _IOC_SIZE(request);
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (fd < 0 || fd != xstub_fd)
+	return __real_ioctl(fd, request, arg);
+
+    if (request == EVIOCGRAB)
+	return 0;
+    if (request == EVIOCGVERSION) {
+	*(int *)arg = EV_VERSION;
+	return 0;
+    }
+    if (request == EVIOCGID) {
+	memcpy(arg, &dev_id, sizeof(dev_id));
+	return 0;
+    }
+    if (_IOC_TYPE(request) == 'E' && _IOC_DIR(request) == _IOC_READ) {
+	if (nr >= 0x20 && nr < 0x20 + EV_CNT) {		/* EVIOCGBIT */
+	    size = size < sizeof(dev_bits[0]) ? size : sizeof(dev_bits[0]);
+	    memcpy(arg, dev_bits[nr - 0x20], size);
+	    return size;
+	}
+	if (nr >= 0x40 && nr < 0x40 + ABS_CNT) {		/* EVIOCGABS */
+	    memcpy(arg, &dev_abs[nr - 0x40], sizeof(struct input_absinfo));
+	    return 0;
+	}
+	if (nr == _IOC_NR(EVIOCGNAME(0))) {
+	    snprintf(arg, size, "%s", dev_name);
+	    return strlen(arg) + 1;
+	}
+	if (nr == _IOC_NR(EVIOCGPROP(0))) {
+	    size = size < sizeof(dev_props) ? size : sizeof(dev_props);
+	    memcpy(arg, dev_props, size);
+	    return size;
+	}
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static unsigned int
+event_millis(const struct input_event *ev)
+{
+    return REPLAY_START + (ev->time.tv_sec - events[0].time.tv_sec) * 1000 +
+	   (ev->time.tv_usec - events[0].time.tv_usec) / 1000;
+}
+
+/* the time of the first frame in which two fingers are down and one of
+ * them has moved from where it was when the second landed, 0 if none */
+static unsigned int
+scroll_motion_millis(void)
+{
+    int landed[SCROLL_SLOTS][2], pos[SCROLL_SLOTS][2];
+    int slot = 0, two = 0, down = 0, first = 0, f, i;
+
+    memset(pos, 0, sizeof(pos));
+    for (f = 0; f < nframes; f++) {
+	for (i = first; i < frame_end[f]; i++) {
+	    const struct input_event *ev = &events[i];
+
+	    if (ev->type == EV_KEY && ev->code == BTN_TOOL_DOUBLETAP)
+		two = ev->value;
+	    else if (ev->type == EV_ABS && ev->code == ABS_MT_SLOT)
+		slot = (ev->value >= 0 && ev->value < SCROLL_SLOTS) ? ev->value : 0;
+	    else if (ev->type == EV_ABS && ev->code == ABS_MT_POSITION_X)
+		pos[slot][0] = ev->value;
+	    else if (ev->type == EV_ABS && ev->code == ABS_MT_POSITION_Y)
+		pos[slot][1] = ev->value;
+	}
+	if (!two) {
+	    down = 0;
+	} else if (!down) {
+	    memcpy(landed, pos, sizeof(landed));
+	    down = 1;
+	} else if (memcmp(landed, pos, sizeof(landed))) {
+	    return event_millis(&events[first]);
+	}
+	first = frame_end[f];
+    }
+    return 0;
+}
+
+/* replay the trace read last with the options set, counting what is
+ * posted and, if pred is given, how the pointer prediction did */
+static void
+replay(InputDriverPtr drv, const char *const *options, struct Counts *counts,
+       struct Prediction *pred)
+{
+    InputInfoPtr pInfo;
+    DeviceIntPtr dev;
+    int f, first = 0;
+    unsigned int millis = REPLAY_START;
+
+    xstub_options = options;
+    xstub_now = REPLAY_START;
+    xstub_reset();
+
+    pInfo = calloc(1, sizeof(*pInfo));
+    dev = calloc(1, sizeof(*dev));
+    if (!pInfo || !dev)
+	fail("out of memory\n");
+    pInfo->name = "replay";
+    pInfo->fd = -1;
+    if (drv->PreInit(drv, pInfo, 0) != Success)
+	fail("PreInit failed\n");
+
+    pInfo->dev = dev;
+    dev->name = pInfo->name;
+    dev->public.devicePrivate = pInfo;
+    if (pInfo->device_control(dev, DEVICE_INIT) != Success ||
+	pInfo->device_control(dev, DEVICE_ON) != Success)
+	fail("the device did not come up\n");
+
+    for (f = 0; f < nframes; f++) {
+	int n = frame_end[f] - first;
+
+	millis = event_millis(&events[first]);
+	if (f > 0)
+	    xstub_run_timers(millis);
+	xstub_now = millis;
+	if (write(xstub_wfd, &events[first], n * sizeof(*events)) != n * sizeof(*events))
+	    fail("frame %d: %s\n", f, strerror(errno));
+	if (f == 0)
+	    noalloc_check(1);
+	pInfo->read_input(pInfo);
+	first = frame_end[f];
+    }
+    xstub_run_timers(millis + REPLAY_TAIL);
+    noalloc_check(0);
+
+    if (pred) {
+	SynapticsPrivate *priv = pInfo->private;
+
+	pred->checked = priv->pred_err_count;
+	pred->rms = pred->base_rms = 0;
+	if (priv->pred_err_count) {
+	    pred->rms = sqrt(priv->pred_err / priv->pred_err_count);
+	    pred->base_rms = sqrt(priv->pred_base_err / priv->pred_err_count);
+	}
+    }
+
+    pInfo->device_control(dev, DEVICE_OFF);
+    pInfo->device_control(dev, DEVICE_CLOSE);
+    drv->UnInit(drv, pInfo, 0);
+    free(dev);
+    free(pInfo);
+
+    counts->frames = nframes;
+    counts->motion = xstub_motion;
+    counts->dx = xstub_dx;
+    counts->dy = xstub_dy;
+    counts->scrolls = xstub_scrolls;
+    counts->presses = xstub_presses;
+    counts->touches = xstub_touches;
+}
+
+static void
+print_counts(const char *prefix, const struct Counts *c)
+{
+    printf("%s%d frames: %d motion to %+d/%+d, %d scroll steps, %d presses, %d touch events\n",
+	   prefix, c->frames, c->motion, c->dx, c->dy, c->scrolls, c->presses, c->touches);
+}
+
+static int
+run_fixture(InputDriverPtr drv, const char *srcdir, const struct Fixture *fx)
+{
+    const char *options[sizeof(fx->options) / sizeof(fx->options[0]) + 1];
+    char path[1024];
+    int grail, n, fails = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", srcdir, fx->trace);
+    read_trace(path);
+
+    for (grail = 0; grail <= 1; grail++) {
+	struct Counts got;
+
+	for (n = 0; fx->options[n]; n++)
+	    options[n] = fx->options[n];
+	options[n++] = grail ? "GrailGestures=on" : "GrailGestures=off";
+	options[n] = NULL;
+
+	replay(drv, options, &got, NULL);
+	printf("%s %s, grail %s: ", memcmp(&got, &fx->expect, sizeof(got)) ? "FAIL" : "PASS",
+	       fx->trace, grail ? "on" : "off");
+	print_counts("", &got);
+	if (memcmp(&got, &fx->expect, sizeof(got))) {
+	    print_counts("  expected ", &fx->expect);
+	    fails++;
+	}
+    }
+    return fails;
+}
+
+static int
+check_prediction(InputDriverPtr drv, const char *srcdir)
+{
+    const char *plain[] = { NULL };
+    const char *predicted[] = { PREDICT_OPTION, NULL };
+    struct Counts without, with;
+    struct Prediction pred;
+    char path[1024];
+    int fails = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", srcdir, PREDICT_TRACE);
+    read_trace(path);
+    replay(drv, plain, &without, NULL);
+    replay(drv, predicted, &with, &pred);
+
+    if (!pred.checked || pred.rms >= pred.base_rms)
+	fails++;
+    printf("%s %s, %s: prediction error %.1f, without prediction %.1f (rms of %d)\n",
+	   fails ? "FAIL" : "PASS", PREDICT_TRACE, PREDICT_OPTION,
+	   pred.rms, pred.base_rms, pred.checked);
+
+    if (abs(with.dx - without.dx) > PREDICT_END_SLACK ||
+	abs(with.dy - without.dy) > PREDICT_END_SLACK) {
+	printf("FAIL %s, %s: motion to %+d/%+d, without prediction %+d/%+d\n",
+	       PREDICT_TRACE, PREDICT_OPTION, with.dx, with.dy, without.dx, without.dy);
+	fails++;
+    }
+    return fails;
+}
+
+static int
+check_scroll_onset(InputDriverPtr drv, const char *srcdir)
+{
+    const char *plain[] = { NULL };
+    struct Counts got;
+    unsigned int moving;
+    char path[1024];
+    int ms;
+
+    snprintf(path, sizeof(path), "%s/%s", srcdir, SCROLL_ONSET_TRACE);
+    read_trace(path);
+    moving = scroll_motion_millis();
+    replay(drv, plain, &got, NULL);
+
+    if (!moving || !xstub_first_scroll) {
+	printf("FAIL %s: %s\n", SCROLL_ONSET_TRACE,
+	       moving ? "no scroll step" : "the fingers never move together");
+	return 1;
+    }
+    ms = (int)(xstub_first_scroll - moving);
+    printf("%s %s: first scroll step %d ms after the fingers started moving (at most %d)\n",
+	   ms > SCROLL_ONSET_LIMIT ? "FAIL" : "PASS", SCROLL_ONSET_TRACE, ms,
+	   SCROLL_ONSET_LIMIT);
+    return ms > SCROLL_ONSET_LIMIT;
+}
+
+int
+main(int argc, char *argv[])
+{
+    InputDriverPtr drv;
+    const char *srcdir;
+    int i, fails = 0;
+
+    synaptics2ModuleData.setup(NULL, NULL, NULL, NULL);
+    drv = xstub_driver;
+    if (!drv)
+	fail("the driver did not register\n");
+
+    if (argc > 1) {
+	struct Counts got;
+
+	read_trace(argv[1]);
+	replay(drv, (const char *const *)argv + 2, &got, NULL);
+	print_counts("", &got);
+	return 0;
+    }
+
+    srcdir = getenv("srcdir");
+    if (!srcdir)
+	srcdir = ".";
+    for (i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++)
+	fails += run_fixture(drv, srcdir, &fixtures[i]);
+    fails += check_prediction(drv, srcdir);
+    fails += check_scroll_onset(drv, srcdir);
+
+    free(events);
+    free(frame_end);
+    return fails ? 1 : 0;
+}
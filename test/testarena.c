@@ -0,0 +1,102 @@
+/*
+ * Checks the per-device arena: reservations size the first block, setup
+ * allocations share it, larger ones chain a block, and a sealed arena
+ * refuses and counts.
+ *
+ *   cc -I../src -o testarena testarena.c ../src/arena.c
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+static int fails;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+	    printf("line %d: %s\n", __LINE__, #cond); \
+	    fails++; \
+	} \
+    } while (0)
+
+static int
+zeroed(const char *p, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+	if (p[i])
+	    return 0;
+    return 1;
+}
+
+static int
+aligned(const void *p)
+{
+    return (uintptr_t)p % sizeof(double) == 0 &&
+	   (uintptr_t)p % sizeof(void *) == 0;
+}
+
+int
+main(void)
+{
+    Arena a;
+    ArenaBlock *first;
+    size_t block_size;
+    char *p, *q, *r;
+
+    /* what was reserved fits the first block, in order */
+    arena_init(&a, 0);
+    arena_reserve(&a, 100);
+    arena_reserve(&a, 3);
+    arena_reserve(&a, 200);
+    p = arena_alloc(&a, 100);
+    first = a.blocks;
+    q = arena_alloc(&a, 3);
+    r = arena_alloc(&a, 200);
+    CHECK(p && q && r);
+    CHECK(a.blocks == first);
+    CHECK(q > p && r > q);
+    CHECK(aligned(p) && aligned(q) && aligned(r));
+    CHECK(zeroed(p, 100) && zeroed(q, 3) && zeroed(r, 200));
+
+    /* reserving once there is a block changes nothing */
+    block_size = a.block_size;
+    arena_reserve(&a, 4096);
+    CHECK(a.block_size == block_size);
+    p = arena_alloc(&a, 1);
+    CHECK(p && a.blocks != first);
+    arena_release(&a);
+    CHECK(a.blocks == NULL);
+
+    /* without reservations blocks come in block_size, larger requests get
+     * a block of their own */
+    arena_init(&a, 64);
+    p = arena_alloc(&a, 16);
+    first = a.blocks;
+    q = arena_alloc(&a, 16);
+    CHECK(a.blocks == first);
+    r = arena_alloc(&a, 1000);
+    CHECK(r && a.blocks != first && zeroed(r, 1000));
+    first = a.blocks;
+    p = arena_alloc(&a, 64);
+    CHECK(p && a.blocks != first);
+
+    /* sealed, it refuses and counts until unsealed */
+    arena_seal(&a, 1);
+    CHECK(arena_alloc(&a, 8) == NULL);
+    CHECK(arena_alloc(&a, 8) == NULL);
+    CHECK(a.refused == 2);
+    arena_seal(&a, 0);
+    CHECK(arena_alloc(&a, 8) != NULL);
+    CHECK(a.refused == 2);
+    arena_release(&a);
+
+    if (fails) {
+	printf("%d failures\n", fails);
+	exit(1);
+    }
+    printf("arena as expected\n");
+    exit(0);
+}
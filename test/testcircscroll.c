@@ -0,0 +1,180 @@
+/*
+ * Checks the circular scrolling angle arithmetic: circ_fast_atan2() against
+ * atan2() over the circle, and the steps circ_steps() takes against the
+ * step loop it replaced, with either atan2 on random circular traces.
+ *
+ *   cc -I../src -o testcircscroll testcircscroll.c ../src/circscroll.c -lm
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "circscroll.h"
+
+#define ATAN2_MAX_ERROR 1e-5	/* rad */
+#define CIRCLE_POINTS 100000
+#define TRACES 200
+#define TRACE_FRAMES 500
+
+static int fails;
+
+static double
+atan2_error(double y, double x)
+{
+    return fabs(circ_diff(atan2(y, x), circ_fast_atan2(y, x)));
+}
+
+static void
+check_atan2_at(const char *what, double y, double x, double *max_error)
+{
+    double e = atan2_error(y, x);
+
+    if (e > *max_error)
+	*max_error = e;
+    if (e > ATAN2_MAX_ERROR) {
+	printf("%s (%g, %g): circ_fast_atan2 %.9f, atan2 %.9f\n",
+	       what, x, y, circ_fast_atan2(y, x), atan2(y, x));
+	fails++;
+    }
+}
+
+static void
+check_atan2(void)
+{
+    static const double radii[] = { 1, 7.5, 1000, 3167 };
+    static const double signs[] = { 1, -1 };
+    double max_error = 0;
+    int i, r, sx, sy;
+
+    for (r = 0; r < (int)(sizeof(radii) / sizeof(radii[0])); r++) {
+	double rad = radii[r];
+
+	for (i = 0; i < CIRCLE_POINTS; i++) {
+	    double a = -M_PI + 2 * M_PI * i / CIRCLE_POINTS;
+
+	    check_atan2_at("circle", rad * sin(a), rad * cos(a), &max_error);
+	}
+
+	/* axis points and octant boundaries, where the polynomial is
+	 * mirrored; both signs of each coordinate, and next to them */
+	for (sx = 0; sx < 2; sx++)
+	    for (sy = 0; sy < 2; sy++) {
+		double x = signs[sx] * rad, y = signs[sy] * rad;
+
+		check_atan2_at("axis", 0, x, &max_error);
+		check_atan2_at("axis", y, 0, &max_error);
+		check_atan2_at("octant", y, x, &max_error);
+		check_atan2_at("octant", nextafter(y, 0), x, &max_error);
+		check_atan2_at("octant", y, nextafter(x, 0), &max_error);
+	    }
+    }
+
+    /* the center has no angle, both say 0 */
+    if (circ_fast_atan2(0, 0) != 0 || atan2(0, 0) != 0) {
+	printf("center: circ_fast_atan2 %g, atan2 %g\n",
+	       circ_fast_atan2(0, 0), atan2(0, 0));
+	fails++;
+    }
+    printf("circ_fast_atan2: largest error %.2g rad\n", max_error);
+}
+
+/* the step loop circ_steps() replaced, one angle() per step */
+static int
+loop_steps(double *scroll_a, double a, double delta)
+{
+    int n = 0;
+
+    while (circ_diff(*scroll_a, a) > delta) {
+	n++;
+	*scroll_a += delta;
+	if (*scroll_a > M_PI)
+	    *scroll_a -= 2 * M_PI;
+    }
+    while (circ_diff(*scroll_a, a) < -delta) {
+	n--;
+	*scroll_a -= delta;
+	if (*scroll_a < -M_PI)
+	    *scroll_a += 2 * M_PI;
+    }
+    return n;
+}
+
+/* a reproducible uniform random number in [0, 1) */
+static double
+random_unit(unsigned int *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return ((*seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+/*
+ * A finger going round the pad center at varying radius and speed, in
+ * whole device units. Every frame the loop, circ_steps() with atan2 and
+ * circ_steps() with circ_fast_atan2() take their steps; the first two have
+ * to agree on every frame, the approximation on the total at the end.
+ */
+static void
+check_steps(void)
+{
+    static const double deltas[] = { 0.1, 0.05, 0.3, 0.0123, M_PI / 4 };
+    unsigned int seed = 1;
+    long frames = 0, fast_frames = 0;
+    int t, f;
+
+    for (t = 0; t < TRACES; t++) {
+	double delta = deltas[t % (sizeof(deltas) / sizeof(deltas[0]))];
+	double a = 2 * M_PI * random_unit(&seed);
+	double rad = 100 + 3000 * random_unit(&seed);
+	double speed = 0.4 * (2 * random_unit(&seed) - 1);
+	double loop_a, exact_a, fast_a;
+	int exact_n = 0, fast_n = 0;
+	int x = rad * cos(a), y = rad * sin(a);
+
+	loop_a = exact_a = fast_a = atan2(-y, x);
+	for (f = 0; f < TRACE_FRAMES; f++) {
+	    int n_loop, n_exact, n_fast;
+
+	    if (random_unit(&seed) < 0.05)
+		speed = -speed;
+	    a += speed * (0.5 + random_unit(&seed));
+	    rad = fmax(50, rad + 40 * (random_unit(&seed) - 0.5));
+	    x = rad * cos(a);
+	    y = rad * sin(a);
+
+	    n_loop = loop_steps(&loop_a, atan2(-y, x), delta);
+	    n_exact = circ_steps(&exact_a, atan2(-y, x), delta, 1 / delta);
+	    n_fast = circ_steps(&fast_a, circ_fast_atan2(-y, x), delta, 1 / delta);
+	    if (n_loop != n_exact) {
+		printf("trace %d, frame %d, step %g: %d steps, the loop took %d\n",
+		       t, f, delta, n_exact, n_loop);
+		fails++;
+	    }
+	    if (n_fast != n_exact)
+		fast_frames++;
+	    exact_n += n_exact;
+	    fast_n += n_fast;
+	    frames++;
+	}
+	if (fast_n != exact_n) {
+	    printf("trace %d, step %g: %d steps with circ_fast_atan2, %d with atan2\n",
+		   t, delta, fast_n, exact_n);
+	    fails++;
+	}
+    }
+    printf("circ_steps: %ld frames, %ld with a step taken a frame apart by "
+	   "circ_fast_atan2\n", frames, fast_frames);
+}
+
+int
+main(void)
+{
+    check_atan2();
+    check_steps();
+
+    if (fails) {
+	printf("%d failures\n", fails);
+	exit(1);
+    }
+    printf("circular scrolling angles as expected\n");
+    exit(0);
+}
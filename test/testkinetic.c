@@ -0,0 +1,138 @@
+/*
+ * Coasts the same flings at 60, 80 and 125 steps per second and checks
+ * that the distance covered and the speed left agree at every common point
+ * in time, and that the motion stops after the same distance.
+ *
+ *   cc -I../src -o testkinetic testkinetic.c ../src/kinetic.c \
+ *      ../src/synhist.c ../src/yolog.c -lm -lcurses
+ *
+ * Steps come at whole milliseconds like timer callbacks, so at 60 and 80
+ * steps per second their spacing alternates.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "kinetic.h"
+
+#define START 1000		/* ms, time of the fling */
+#define CHECK_EVERY 200		/* ms, common to all rates */
+#define LIMIT 20000		/* ms, a fling that coasts longer fails */
+#define EPSILON 1e-6		/* relative */
+
+struct Fling {
+    const char *name;
+    double vx, vy;		/* units per second */
+    double friction;		/* units per second^2 */
+    double tau;			/* seconds */
+    double stop_speed;
+};
+
+static const struct Fling flings[] = {
+    { "decay", 0, 3000, 0, 0.3, 20 },
+    { "friction", 1200, -900, 4000, 0, 20 },
+    { "decay and friction", -2500, 400, 1500, 0.5, 20 },
+    { "slow", 0, 30, 0, 0.3, 20 },
+};
+
+static const int rates[] = { 60, 80, 125 };
+
+#define NRATES (int)(sizeof(rates) / sizeof(rates[0]))
+#define NCHECKS (LIMIT / CHECK_EVERY + 1)
+
+struct Run {
+    double x[NCHECKS], y[NCHECKS];	/* distance covered at each check */
+    double speed[NCHECKS];		/* speed left at each check */
+    double total_x, total_y;		/* distance covered when it stopped */
+    int stopped;			/* ms after the fling */
+};
+
+static void
+coast(const struct Fling *f, int rate, struct Run *run)
+{
+    KineticScroll k;
+    double x = 0, y = 0, dx, dy;
+    int i, t, active;
+
+    kinetic_start(&k, f->vx, f->vy, f->friction, f->tau, f->stop_speed, START);
+    active = k.active;
+    run->stopped = 0;
+    for (i = 1; active; i++) {
+	/* the ms of the i-th step, rounded like a timer would fire */
+	t = (i * 1000 + rate / 2) / rate;
+	if (t > LIMIT)
+	    break;
+	active = kinetic_step(&k, START + t, &dx, &dy);
+	x += dx;
+	y += dy;
+	if (t % CHECK_EVERY == 0) {
+	    run->x[t / CHECK_EVERY] = x;
+	    run->y[t / CHECK_EVERY] = y;
+	    run->speed[t / CHECK_EVERY] = hypot(k.vx, k.vy);
+	}
+	if (!active)
+	    run->stopped = t;
+    }
+    run->total_x = x;
+    run->total_y = y;
+}
+
+static int
+differs(double a, double b)
+{
+    return fabs(a - b) > EPSILON * (fabs(a) + fabs(b) + 1);
+}
+
+static int
+run_fling(const struct Fling *f)
+{
+    struct Run runs[NRATES];
+    int r, c, fails = 0;
+
+    for (r = 0; r < NRATES; r++)
+	coast(f, rates[r], &runs[r]);
+
+    for (r = 0; r < NRATES; r++) {
+	const struct Run *a = &runs[0], *b = &runs[r];
+
+	if (!b->stopped) {
+	    printf("%s at %d/s: still coasting after %d ms\n", f->name, rates[r], LIMIT);
+	    fails++;
+	    continue;
+	}
+	if (differs(a->total_x, b->total_x) || differs(a->total_y, b->total_y)) {
+	    printf("%s: stops after %.3f/%.3f at %d/s, %.3f/%.3f at %d/s\n",
+		   f->name, a->total_x, a->total_y, rates[0],
+		   b->total_x, b->total_y, rates[r]);
+	    fails++;
+	}
+	/* checks both runs passed while coasting */
+	for (c = 1; c * CHECK_EVERY < a->stopped && c * CHECK_EVERY < b->stopped; c++)
+	    if (differs(a->x[c], b->x[c]) || differs(a->y[c], b->y[c]) ||
+		differs(a->speed[c], b->speed[c])) {
+		printf("%s, %d ms: %.3f/%.3f at %.3f/s after %d/s, "
+		       "%.3f/%.3f at %.3f/s after %d/s\n", f->name, c * CHECK_EVERY,
+		       a->x[c], a->y[c], a->speed[c], rates[0],
+		       b->x[c], b->y[c], b->speed[c], rates[r]);
+		fails++;
+	    }
+    }
+    return fails;
+}
+
+int
+main(void)
+{
+    const int nflings = sizeof(flings) / sizeof(flings[0]);
+    int i, fails = 0;
+
+    for (i = 0; i < nflings; i++)
+	fails += run_fling(&flings[i]);
+
+    if (fails) {
+	printf("%d failures\n", fails);
+	exit(1);
+    }
+    printf("all flings coast alike at every rate\n");
+    exit(0);
+}
@@ -0,0 +1,101 @@
+/*
+ * Checks the token bucket behind every logging call site: the burst, the
+ * refill of one message per period, the cap after a quiet spell, and that
+ * every dropped message is reported with the next one let through.
+ *
+ *   cc -I../src -o testratelimit testratelimit.c ../src/yolog.c -lcurses
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "yolog.h"
+
+#define START 5000		/* ms, any point on the monotonic clock */
+#define STREAM_HZ 100		/* a message on every report */
+#define STREAM_SECONDS 60
+
+static int fails;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+	    printf("line %d: %s\n", __LINE__, #cond); \
+	    fails++; \
+	} \
+    } while (0)
+
+/* messages let through at now out of n tries; *reported sums what the
+ * ones let through said was suppressed before them */
+static int
+take(yolog_ratelimit *rl, long long now, int n, unsigned long *reported)
+{
+    unsigned long suppressed;
+    int i, passed = 0;
+
+    for (i = 0; i < n; i++)
+	if (yolog_ratelimit_take(rl, now, &suppressed)) {
+	    passed++;
+	    *reported += suppressed;
+	}
+    return passed;
+}
+
+int
+main(void)
+{
+    yolog_ratelimit rl;
+    unsigned long reported = 0, suppressed;
+    int i, passed;
+
+    /* a burst, then nothing until a period has passed */
+    memset(&rl, 0, sizeof(rl));
+    CHECK(take(&rl, START, YOLOG_RL_BURST, &reported) == YOLOG_RL_BURST);
+    CHECK(reported == 0);
+    CHECK(take(&rl, START, 5, &reported) == 0);
+    CHECK(take(&rl, START + YOLOG_RL_PERIOD - 1, 5, &reported) == 0);
+
+    /* one token back, which says what was dropped */
+    CHECK(yolog_ratelimit_take(&rl, START + YOLOG_RL_PERIOD, &suppressed));
+    CHECK(suppressed == 10);
+    CHECK(!yolog_ratelimit_take(&rl, START + YOLOG_RL_PERIOD, &suppressed));
+
+    /* a token taken halfway through a period leaves the half towards the
+     * next one */
+    CHECK(yolog_ratelimit_take(&rl, START + YOLOG_RL_PERIOD * 5 / 2, &suppressed));
+    CHECK(suppressed == 1);
+    CHECK(yolog_ratelimit_take(&rl, START + 3 * YOLOG_RL_PERIOD, &suppressed));
+    CHECK(suppressed == 0);
+
+    /* three periods earn three tokens */
+    CHECK(take(&rl, START + 6 * YOLOG_RL_PERIOD, 10, &reported) == 3);
+
+    /* a quiet spell earns no more than a burst, and the time beyond it
+     * isn't kept for later */
+    memset(&rl, 0, sizeof(rl));
+    reported = 0;
+    CHECK(take(&rl, START, 1, &reported) == 1);
+    CHECK(take(&rl, START + 1000 * YOLOG_RL_PERIOD, 100, &reported) == YOLOG_RL_BURST);
+    CHECK(take(&rl, START + 1001 * YOLOG_RL_PERIOD - 1, 100, &reported) == 0);
+    CHECK(take(&rl, START + 1001 * YOLOG_RL_PERIOD, 100, &reported) == 1);
+    CHECK(reported == 190);
+
+    /* a message on every report: the burst, then one per period, and
+     * every message is either let through or reported as suppressed */
+    memset(&rl, 0, sizeof(rl));
+    reported = 0;
+    passed = 0;
+    for (i = 0; i < STREAM_HZ * STREAM_SECONDS; i++)
+	passed += take(&rl, START + i * 1000LL / STREAM_HZ, 1, &reported);
+    CHECK(passed == YOLOG_RL_BURST + STREAM_SECONDS * 1000 / YOLOG_RL_PERIOD - 1);
+    CHECK(passed + reported + rl.suppressed == STREAM_HZ * STREAM_SECONDS);
+    printf("%d messages at %d/s for %d s: %d written, %lu suppressed\n",
+	   STREAM_HZ * STREAM_SECONDS, STREAM_HZ, STREAM_SECONDS, passed,
+	   reported + rl.suppressed);
+
+    if (fails) {
+	printf("%d failures\n", fails);
+	exit(1);
+    }
+    printf("rate limit as expected\n");
+    exit(0);
+}
@@ -0,0 +1,243 @@
+/*
+ * Runs the tap and drag table through all of its rows and checks the tap
+ * button the driver would post for every frame.
+ *
+ *   cc -I../src -o testtaptable testtaptable.c ../src/taptable.c
+ *
+ * Each frame lists the events handed to tap_step(), the states entered by
+ * the rows taken (one letter per row, so TR_AGAIN chains show up as more
+ * than one) and the button events posted, P for press and R for release.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "taptable.h"
+
+#define T  TI_TOUCH
+#define R  TI_RELEASE
+#define M  TI_MOVE
+#define TO TI_TIMEOUT
+
+#define DRAG	TC_TAP_AND_DRAG
+#define LOCKED	TC_LOCKED_DRAGS
+#define FAST	TC_FAST_TAPS
+
+struct Frame {
+    int events;
+    const char *path;
+    const char *posted;
+};
+
+struct Case {
+    const char *name;
+    int conds;
+    struct Frame frames[16];
+};
+
+static const char state_names[TAP_STATES] = {
+    [TS_START] = 'S', [TS_1] = '1', [TS_MOVE] = 'M', [TS_2A] = 'a',
+    [TS_2B] = 'b', [TS_SINGLETAP] = 'T', [TS_3] = '3', [TS_DRAG] = 'D',
+    [TS_4] = '4', [TS_5] = '5',
+};
+
+static const struct Case cases[] = {
+    { "single tap", DRAG, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ TO,	"T",	"P" },
+	{ TO,	"S",	"R" },
+    } },
+    { "single tap, fast taps", DRAG | FAST, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"P" },
+	{ TO,	"T",	"R" },
+	{ TO,	"S",	"" },
+    } },
+    { "tap, then touch during the click", DRAG, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ TO,	"T",	"P" },
+	{ T,	"1",	"R" },
+	{ R,	"a",	"" },
+	{ TO,	"T",	"P" },
+	{ TO,	"S",	"R" },
+    } },
+    { "move", 0, {
+	{ T,	"1",	"" },
+	{ M,	"MM",	"" },
+	{ M,	"M",	"" },
+	{ R,	"S",	"" },
+    } },
+    { "hold", 0, {
+	{ T,	"1",	"" },
+	{ TO,	"M",	"" },
+	{ R,	"S",	"" },
+    } },
+    { "double tap", DRAG, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"P" },
+	{ R,	"b",	"R" },
+	{ TO,	"S",	"PR" },
+    } },
+    { "double tap, no drag gesture", 0, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"" },
+	{ R,	"b",	"" },
+	{ TO,	"S",	"PR" },
+    } },
+    { "triple tap", DRAG, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"P" },
+	{ R,	"b",	"R" },
+	{ T,	"3",	"P" },
+	{ R,	"b",	"R" },
+	{ TO,	"S",	"PR" },
+    } },
+    { "tap and drag", DRAG, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"P" },
+	{ M,	"DD",	"" },
+	{ M,	"D",	"" },
+	{ R,	"S",	"R" },
+    } },
+    { "tap and hold", DRAG, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"P" },
+	{ TO,	"D",	"" },
+	{ R,	"S",	"R" },
+    } },
+    { "tap and move, no drag gesture", 0, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"" },
+	{ M,	"1MM",	"" },
+	{ R,	"S",	"" },
+    } },
+    { "tap and hold, no drag gesture", 0, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"" },
+	{ TO,	"1M",	"" },
+	{ R,	"S",	"" },
+    } },
+    { "locked drag", DRAG | LOCKED, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"P" },
+	{ M,	"DD",	"" },
+	{ R,	"4",	"" },
+	{ T,	"5",	"" },
+	{ M,	"DD",	"" },
+	{ R,	"4",	"" },
+	{ T,	"5",	"" },
+	{ TO,	"D",	"" },
+	{ R,	"4",	"" },
+	{ TO,	"S",	"R" },
+    } },
+    { "locked drag, tap to end", DRAG | LOCKED, {
+	{ T,	"1",	"" },
+	{ R,	"a",	"" },
+	{ T,	"3",	"P" },
+	{ M,	"DD",	"" },
+	{ R,	"4",	"" },
+	{ T,	"5",	"" },
+	{ R,	"S",	"R" },
+    } },
+};
+
+struct Run {
+    char path[TAP_STATES * TAP_ROWS + 1];
+    int len;
+};
+
+static unsigned char taken[TAP_STATES][TAP_ROWS];
+
+static void
+record(void *data, enum TapState from, const struct TapTransition *t)
+{
+    struct Run *run = data;
+
+    taken[from][t - tap_table[from]] = 1;
+    run->path[run->len++] = state_names[t->next];
+    run->path[run->len] = '\0';
+}
+
+/* what HandleState posts for the tap button of one frame */
+static void
+post(enum TapButtonState *button, int *down, char *posted)
+{
+    int want;
+
+    if (*button == TBS_BUTTON_DOWN_UP) {
+	if (!*down) {
+	    strcat(posted, "P");
+	    *down = 1;
+	}
+	*button = TBS_BUTTON_UP;
+    }
+    want = (*button == TBS_BUTTON_DOWN);
+    if (*down && !want)
+	strcat(posted, "R");
+    else if (!*down && want)
+	strcat(posted, "P");
+    *down = want;
+}
+
+static int
+run_case(const struct Case *c)
+{
+    enum TapState state = TS_START;
+    enum TapButtonState button = TBS_BUTTON_UP;
+    const struct Frame *f;
+    int down = 0, fails = 0;
+
+    for (f = c->frames; f->events; f++) {
+	struct Run run = { "", 0 };
+	char posted[8] = "";
+
+	tap_step(&state, &button, f->events, c->conds, record, &run);
+	post(&button, &down, posted);
+	if (strcmp(run.path, f->path) || strcmp(posted, f->posted)) {
+	    printf("%s, frame %d: states \"%s\" posted \"%s\", "
+		   "expected \"%s\" \"%s\"\n", c->name, (int)(f - c->frames),
+		   run.path, posted, f->path, f->posted);
+	    fails++;
+	}
+    }
+    if (state != TS_START || down) {
+	printf("%s: ends in state %c with the button %s\n", c->name,
+	       state_names[state], down ? "down" : "up");
+	fails++;
+    }
+    return fails;
+}
+
+int
+main(void)
+{
+    const int ncases = sizeof(cases) / sizeof(cases[0]);
+    int i, j, fails = 0;
+
+    for (i = 0; i < ncases; i++)
+	fails += run_case(&cases[i]);
+
+    for (i = 0; i < TAP_STATES; i++)
+	for (j = 0; j < TAP_ROWS && tap_table[i][j].events; j++)
+	    if (!taken[i][j]) {
+		printf("state %c: row %d never taken\n", state_names[i], j);
+		fails++;
+	    }
+
+    if (fails) {
+	printf("%d failures\n", fails);
+	exit(1);
+    }
+    printf("all rows taken, all buttons as expected\n");
+    exit(0);
+}
@@ -0,0 +1,145 @@
+/*
+ * Checks the pad zone map: for every point of a few pads, and a margin
+ * around them, zone_edges(), zone_active() and zone_button() have to
+ * answer what the exact tests answer, and inside the range the map alone
+ * has to answer most of those lookups.
+ *
+ *   cc -I../src -o testzonemap testzonemap.c ../src/zonemap.c
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "zonemap.h"
+
+#define MARGIN 64		/* device units checked around the range */
+#define OPEN { INT_MIN, INT_MAX, INT_MIN, INT_MAX }	/* a button area that is off */
+
+struct Pad {
+    const char *name;
+    int minx, maxx, miny, maxy;
+    int edges[4];		/* left, right, top, bottom */
+    int circular;
+    int area[4];		/* left, right, top, bottom, 0 for open */
+    int buttons[ZONE_BUTTON_AREAS][4];	/* right, middle: left, right, top, bottom */
+    double map_share;		/* lookups in range the map has to answer alone, at least */
+};
+
+static const struct Pad pads[] = {
+    { "synaptics", 1472, 5472, 1408, 4448, { 1632, 5312, 1568, 4288 }, 0,
+      { 0, 0, 0, 0 }, { OPEN, OPEN }, 0.9 },
+    { "clickpad", -2909, 3167, -2456, 2565, { -2700, 2950, -2250, 2350 }, 0,
+      { -2600, 3000, -2300, 2400 },
+      { { 400, INT_MAX, 1900, INT_MAX }, { -600, 399, 1900, INT_MAX } }, 0.8 },
+    { "circular", 0, 1000, 0, 1000, { 100, 900, 100, 900 }, 1,
+      { 0, 0, 0, 0 }, { OPEN, OPEN }, 0.85 },
+    { "circular, uneven", -2909, 3167, -2456, 2565, { -2500, 2800, -2000, 2100 }, 1,
+      { -2800, 0, 0, 2500 }, { { 0, INT_MAX, 2000, INT_MAX }, OPEN }, 0.75 },
+    { "edges outside", 0, 255, 0, 255, { -10, 300, -10, 300 }, 0,
+      { 0, 0, 0, 0 }, { { INT_MIN, INT_MAX, 200, INT_MAX }, OPEN }, 0.9 },
+    { "no range", 0, 0, 0, 0, { -1, 1, -1, 1 }, 0,
+      { 0, 0, 0, 0 }, { OPEN, OPEN }, 0 },
+};
+
+/* set the bounds up the way SynapticsCompileParams() does */
+static void
+setup(ZoneMap *z, const struct Pad *pad)
+{
+    int i, j;
+
+    z->left_edge = pad->edges[0];
+    z->right_edge = pad->edges[1];
+    z->top_edge = pad->edges[2];
+    z->bottom_edge = pad->edges[3];
+    z->circular = pad->circular;
+    z->center_x = (z->left_edge + z->right_edge) / 2.0;
+    z->center_y = (z->top_edge + z->bottom_edge) / 2.0;
+    if (z->right_edge > z->center_x && z->bottom_edge > z->center_y) {
+	z->inv_half_x = 1.0 / (z->right_edge - z->center_x);
+	z->inv_half_y = 1.0 / (z->bottom_edge - z->center_y);
+    } else {
+	z->inv_half_x = z->inv_half_y = 0;
+    }
+
+    z->area_left_edge = pad->area[0];
+    z->area_right_edge = pad->area[1];
+    z->area_top_edge = pad->area[2];
+    z->area_bottom_edge = pad->area[3];
+
+    z->button_band_top = INT_MAX;
+    for (i = 0; i < ZONE_BUTTON_AREAS; i++) {
+	const int *area = pad->buttons[i];
+	int *zone = z->button_zone[i];
+
+	if (area[0] == INT_MIN && area[1] == INT_MAX &&
+	    area[2] == INT_MIN && area[3] == INT_MAX) {
+	    zone[0] = zone[2] = INT_MAX;
+	    zone[1] = zone[3] = INT_MIN;
+	    continue;
+	}
+	for (j = 0; j < 4; j++)
+	    zone[j] = area[j];
+	if (zone[2] < z->button_band_top)
+	    z->button_band_top = zone[2];
+    }
+
+    zone_map_build(z, pad->minx, pad->maxx, pad->miny, pad->maxy);
+}
+
+static int
+check_pad(const struct Pad *pad)
+{
+    static ZoneMap z;
+    long points = 0, lookups = 0, mapped = 0;
+    int x, y, fails = 0;
+    double share;
+
+    setup(&z, pad);
+
+    for (y = pad->miny - MARGIN; y <= pad->maxy + MARGIN; y++)
+	for (x = pad->minx - MARGIN; x <= pad->maxx + MARGIN; x++) {
+	    unsigned int cell = zone_cell(&z, x, y);
+	    int edges = zone_edges(&z, x, y), exact_edges = zone_edges_exact(&z, x, y);
+	    int active = zone_active(&z, x, y), exact_active = zone_active_exact(&z, x, y);
+	    int button = zone_button(&z, x, y), exact_button = zone_button_exact(&z, x, y);
+
+	    if (edges != exact_edges || active != exact_active || button != exact_button) {
+		if (fails++ < 10)
+		    printf("%s (%d, %d): edges %d, active %d, button %d; "
+			   "exactly %d, %d, %d\n", pad->name, x, y, edges, active,
+			   button, exact_edges, exact_active, exact_button);
+	    }
+	    points++;
+	    if (x < pad->minx || x > pad->maxx || y < pad->miny || y > pad->maxy)
+		continue;
+	    lookups += 3;
+	    mapped += !(cell & ZONE_CELL_EXACT_EDGE) + !(cell & ZONE_CELL_EXACT_ACTIVE) +
+		      !(cell & ZONE_CELL_EXACT_BUTTON);
+	}
+
+    share = (double)mapped / lookups;
+    printf("%s: %ld points, %.1f%% of the lookups in range answered by the map\n",
+	   pad->name, points, 100 * share);
+    if (share < pad->map_share) {
+	printf("%s: the map answers less than %.0f%%\n", pad->name,
+	       100 * pad->map_share);
+	fails++;
+    }
+    return fails;
+}
+
+int
+main(void)
+{
+    int i, fails = 0;
+
+    for (i = 0; i < (int)(sizeof(pads) / sizeof(pads[0])); i++)
+	fails += check_pad(&pads[i]);
+
+    if (fails) {
+	printf("%d failures\n", fails);
+	exit(1);
+    }
+    printf("zone map as exact as the tests\n");
+    exit(0);
+}
@@ -0,0 +1,484 @@
+/*
+ * Stand-ins for the X server functions the driver links against. Pointers
+ * to server structures are void * here and the stubs only do what the
+ * driver relies on. Messages are printed like the server does at its
+ * default verbosity, through stdio, so one from the replayed frames trips
+ * noalloc.c just as it would be unsafe in the SIGIO handler.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "xstubs.h"
+
+#define XSTUB_VERBOSITY 3	/* the server's default log verbosity */
+#define XSTUB_VALUATORS 36	/* MAX_VALUATORS */
+
+void *xstub_driver;
+const char *xstub_device = "/dev/input/event-replay";
+const char *const *xstub_options;
+int xstub_fd = -1;
+int xstub_wfd = -1;
+unsigned int xstub_now;
+
+int xstub_motion;
+int xstub_scrolls;
+int xstub_presses;
+int xstub_touches;
+int xstub_dx, xstub_dy;
+unsigned int xstub_first_scroll;
+
+/* scroll valuator increments and the motion on them not yet counted */
+static double xstub_increment[XSTUB_VALUATORS];
+static double xstub_scrolled[XSTUB_VALUATORS];
+
+/* messages */
+
+static void
+xstub_vlog(int verb, const char *format, va_list ap)
+{
+    if (verb <= XSTUB_VERBOSITY)
+	vfprintf(stderr, format, ap);
+}
+
+int
+xf86GetVerbosity(void)
+{
+    return XSTUB_VERBOSITY;
+}
+
+void
+xf86Msg(int type, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    xstub_vlog(1, format, ap);
+    va_end(ap);
+}
+
+void
+xf86MsgVerb(int type, int verb, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    xstub_vlog(verb, format, ap);
+    va_end(ap);
+}
+
+void
+xf86ErrorFVerb(int verb, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    xstub_vlog(verb, format, ap);
+    va_end(ap);
+}
+
+void
+ErrorF(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    xstub_vlog(0, format, ap);
+    va_end(ap);
+}
+
+/* signal safe: no formatting, just the format string */
+void
+LogMessageVerbSigSafe(int type, int verb, const char *format, ...)
+{
+    if (verb <= XSTUB_VERBOSITY && write(STDERR_FILENO, format, strlen(format)) < 0)
+	return;
+}
+
+void
+xstub_reset(void)
+{
+    xstub_motion = xstub_scrolls = xstub_presses = xstub_touches = 0;
+    xstub_dx = xstub_dy = 0;
+    xstub_first_scroll = 0;
+    memset(xstub_scrolled, 0, sizeof(xstub_scrolled));
+}
+
+/* time and timers */
+
+struct xstub_timer {
+    int armed;
+    unsigned int when;
+    unsigned int (*callback)(void *timer, unsigned int now, void *arg);
+    void *arg;
+};
+
+static struct xstub_timer *xstub_timer;
+
+unsigned int
+GetTimeInMillis(void)
+{
+    return xstub_now;
+}
+
+void *
+TimerSet(void *t, int flags, unsigned int millis,
+	 unsigned int (*callback)(void *, unsigned int, void *), void *arg)
+{
+    struct xstub_timer *timer = t;
+
+    if (!timer) {
+	timer = calloc(1, sizeof(*timer));
+	if (!timer)
+	    return NULL;
+    }
+    timer->armed = 0;
+    if (!millis)
+	return timer;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->when = (flags & 1) ? millis : xstub_now + millis;	/* TimerAbsolute */
+    timer->armed = 1;
+    xstub_timer = timer;
+    /* like the server, a deadline that has passed fires right away */
+    if ((int)(timer->when - xstub_now) <= 0)
+	xstub_run_timers(xstub_now);
+    return timer;
+}
+
+void
+TimerCancel(void *t)
+{
+    struct xstub_timer *timer = t;
+
+    if (timer)
+	timer->armed = 0;
+}
+
+void
+TimerFree(void *t)
+{
+    if (t == xstub_timer)
+	xstub_timer = NULL;
+    free(t);
+}
+
+void
+xstub_run_timers(unsigned int until)
+{
+    struct xstub_timer *timer = xstub_timer;
+    unsigned int next;
+
+    while (timer && timer->armed && (int)(timer->when - until) <= 0) {
+	xstub_now = timer->when;
+	timer->armed = 0;
+	next = timer->callback(timer, xstub_now, timer->arg);
+	if (next)
+	    TimerSet(timer, 0, next, timer->callback, timer->arg);
+    }
+    xstub_now = until;
+}
+
+/* the device */
+
+int
+xf86OpenSerial(void *options)
+{
+    int fds[2];
+
+    if (pipe(fds) < 0)
+	return -1;
+    if (fcntl(fds[0], F_SETFL, O_NONBLOCK) < 0) {
+	close(fds[0]);
+	close(fds[1]);
+	return -1;
+    }
+    xstub_fd = fds[0];
+    xstub_wfd = fds[1];
+    return xstub_fd;
+}
+
+int
+xf86CloseSerial(int fd)
+{
+    if (fd == xstub_fd) {
+	close(xstub_wfd);
+	xstub_fd = xstub_wfd = -1;
+    }
+    return close(fd);
+}
+
+void xf86FlushInput(int fd) { }
+int xf86WaitForInput(int fd, int timeout) { return 0; }
+int xf86ReadSerial(int fd, void *buf, int count) { errno = EIO; return -1; }
+int xf86WriteSerial(int fd, const void *buf, int count) { errno = EIO; return -1; }
+int xf86BlockSIGIO(void) { return 0; }
+void xf86UnblockSIGIO(int wasset) { }
+void xf86AddEnabledDevice(void *pInfo) { }
+void xf86RemoveEnabledDevice(void *pInfo) { }
+
+void *XisbNew(int fd, int size) { static char buffer; return &buffer; }
+void XisbFree(void *b) { }
+int XisbRead(void *b) { return -1; }
+void XisbBlockDuration(void *b, int duration) { }
+
+/* options: the overrides in xstub_options, everything else at its default */
+
+static const char *
+xstub_option(const char *name)
+{
+    const char *const *o;
+    size_t len = strlen(name);
+
+    if (!strcmp(name, "Device"))
+	return xstub_device;
+    for (o = xstub_options; o && *o; o++)
+	if (!strncasecmp(*o, name, len) && (*o)[len] == '=')
+	    return *o + len + 1;
+    return NULL;
+}
+
+int
+xf86SetIntOption(void *opts, const char *name, int deflt)
+{
+    const char *v = xstub_option(name);
+
+    return v ? atoi(v) : deflt;
+}
+
+int
+xf86SetBoolOption(void *opts, const char *name, int deflt)
+{
+    const char *v = xstub_option(name);
+
+    if (!v)
+	return deflt;
+    return !strcasecmp(v, "on") || !strcasecmp(v, "true") ||
+	   !strcasecmp(v, "yes") || !strcmp(v, "1");
+}
+
+double
+xf86SetRealOption(void *opts, const char *name, double deflt)
+{
+    const char *v = xstub_option(name);
+
+    return v ? strtod(v, NULL) : deflt;
+}
+
+char *
+xf86SetStrOption(void *opts, const char *name, const char *deflt)
+{
+    const char *v = xstub_option(name);
+
+    return (char *)(v ? v : deflt);
+}
+
+char *
+xf86FindOptionValue(void *opts, const char *name)
+{
+    return (char *)xstub_option(name);
+}
+
+double xf86SetPercentOption(void *opts, const char *name, double deflt) { return deflt; }
+double xf86CheckPercentOption(void *opts, const char *name, double deflt) { return -1; }
+void *xf86ReplaceStrOption(void *opts, const char *name, const char *val) { return opts; }
+
+/* driver and device setup */
+
+void
+xf86AddInputDriver(void *driver, void *module, int flags)
+{
+    xstub_driver = driver;
+}
+
+void xf86ProcessCommonOptions(void *pInfo, void *options) { }
+void xf86DeleteInput(void *pInfo, int flags) { }
+
+int InitPointerDeviceStruct(void *dev, void *map, int buttons, void *btn_labels,
+			    void *ctrl, int history, int axes, void *axes_labels) { return 1; }
+int InitKeyboardDeviceStruct(void *dev, void *rmlvo, void *bell, void *ctrl) { return 1; }
+int GetMotionHistorySize(void) { return 0; }
+int xf86InitValuatorAxisStruct(void *dev, int axnum, unsigned int label, int minval,
+			       int maxval, int resolution, int min_res, int max_res,
+			       int mode) { return 1; }
+void xf86InitValuatorDefaults(void *dev, int axnum) { }
+
+int
+SetScrollValuator(void *dev, int axnum, int type, double increment, int flags)
+{
+    xstub_increment[axnum] = increment;
+    return 1;
+}
+int InitTouchClassDeviceStruct(void *dev, unsigned int max_touches, unsigned int mode,
+			       unsigned int num_axes) { return 1; }
+int xf86InitTouchValuatorAxisStruct(void *dev, int axnum, unsigned int label, int minval,
+				    int maxval, int resolution) { return 1; }
+
+static unsigned int xstub_atoms = 1;
+
+unsigned int MakeAtom(const char *name, unsigned int len, int create) { return xstub_atoms++; }
+unsigned int XIGetKnownProperty(const char *name) { return xstub_atoms++; }
+int XIChangeDeviceProperty(void *dev, unsigned int property, unsigned int type, int format,
+			   int mode, unsigned long len, const void *value,
+			   int sendevent) { return 0; }
+int XISetDevicePropertyDeletable(void *dev, unsigned int property, int deletable) { return 0; }
+long XIRegisterPropertyHandler(void *dev, void *set, void *get, void *del) { return 1; }
+
+/* room for any server's DeviceVelocityRec */
+static union {
+    char bytes[4096];
+    double align;
+} xstub_velocity;
+
+void *GetDevicePredictableAccelData(void *dev) { return &xstub_velocity; }
+int SetDeviceSpecificAccelerationProfile(void *vel, void *profile) { return 1; }
+
+/* valuator masks */
+
+typedef struct {
+    int set[XSTUB_VALUATORS];
+    double value[XSTUB_VALUATORS];
+} xstub_mask;
+
+void *
+valuator_mask_new(int num_valuators)
+{
+    return calloc(1, sizeof(xstub_mask));
+}
+
+void
+valuator_mask_free(void **mask)
+{
+    free(*mask);
+    *mask = NULL;
+}
+
+void
+valuator_mask_zero(void *mask)
+{
+    memset(mask, 0, sizeof(xstub_mask));
+}
+
+void
+valuator_mask_copy(void *dest, const void *src)
+{
+    if (src)
+	memcpy(dest, src, sizeof(xstub_mask));
+    else
+	memset(dest, 0, sizeof(xstub_mask));
+}
+
+int
+valuator_mask_size(const void *mask)
+{
+    const xstub_mask *m = mask;
+    int i, n = 0;
+
+    for (i = 0; i < XSTUB_VALUATORS; i++)
+	if (m->set[i])
+	    n = i + 1;
+    return n;
+}
+
+int valuator_mask_isset(const void *mask, int i) { return ((const xstub_mask *)mask)->set[i]; }
+int valuator_mask_get(const void *mask, int i) { return ((const xstub_mask *)mask)->value[i]; }
+double valuator_mask_get_double(const void *mask, int i) { return ((const xstub_mask *)mask)->value[i]; }
+void valuator_mask_unset(void *mask, int i) { ((xstub_mask *)mask)->set[i] = 0; }
+
+void
+valuator_mask_set_double(void *mask, int i, double value)
+{
+    ((xstub_mask *)mask)->set[i] = 1;
+    ((xstub_mask *)mask)->value[i] = value;
+}
+
+void
+valuator_mask_set(void *mask, int i, int value)
+{
+    valuator_mask_set_double(mask, i, value);
+}
+
+/* events */
+
+void
+xf86PostMotionEvent(void *dev, int is_absolute, int first_valuator,
+		    int num_valuators, ...)
+{
+    va_list args;
+
+    xstub_motion++;
+    if (is_absolute || first_valuator != 0 || num_valuators != 2)
+	return;
+    va_start(args, num_valuators);
+    xstub_dx += va_arg(args, int);
+    xstub_dy += va_arg(args, int);
+    va_end(args);
+}
+
+/* scroll valuator motion is counted in whole scroll steps */
+void
+xf86PostMotionEventM(void *dev, int is_absolute, const void *mask)
+{
+    const xstub_mask *m = mask;
+    int i;
+
+    for (i = 2; i <= 3; i++) {
+	if (!m->set[i] || xstub_increment[i] <= 0)
+	    continue;
+	xstub_scrolled[i] += m->value[i];
+	while (fabs(xstub_scrolled[i]) >= xstub_increment[i]) {
+	    xstub_scrolled[i] -= copysign(xstub_increment[i], xstub_scrolled[i]);
+	    xstub_scrolls++;
+	    if (!xstub_first_scroll)
+		xstub_first_scroll = xstub_now;
+	}
+    }
+    if (m->set[0] || m->set[1])
+	xstub_motion++;
+}
+
+/* without scroll valuators the driver scrolls with buttons 4 to 7 */
+void
+xf86PostButtonEvent(void *dev, int is_absolute, int button, int is_down,
+		    int first_valuator, int num_valuators, ...)
+{
+    if (button >= 4 && button <= 7) {
+	xstub_scrolls += is_down;
+	if (is_down && !xstub_first_scroll)
+	    xstub_first_scroll = xstub_now;
+    } else
+	xstub_presses += is_down;
+}
+
+void
+xf86PostKeyboardEvent(void *dev, unsigned int key_code, int is_down)
+{
+    xstub_presses += is_down;
+}
+
+void
+xf86PostTouchEvent(void *dev, uint32_t touchid, uint16_t type, uint32_t flags,
+		   const void *mask)
+{
+    xstub_touches++;
+}
+
+/* grail.c, see grailstubs.c for the library */
+
+void *xf86CoordinatesToWindow(int x, int y, int screen) { return NULL; }
+
+void
+xf86PostGestureEvent(void *dev, unsigned short x, unsigned short y,
+		     unsigned short client_id, unsigned short gesture_id,
+		     unsigned short gesture_type, unsigned long root,
+		     unsigned long event, unsigned long child,
+		     unsigned short status, unsigned short num_props, float *props)
+{
+}
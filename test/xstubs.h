@@ -0,0 +1,31 @@
+#ifndef XSTUBS_H
+#define XSTUBS_H
+
+/*
+ * The few parts of the X server the driver calls, enough to bring a device
+ * up and feed it events without a server. The stubs are declared without
+ * the server headers, so they link against any server version the driver
+ * builds with.
+ */
+
+extern void *xstub_driver;		/* InputDriverPtr passed to xf86AddInputDriver() */
+extern const char *xstub_device;	/* the Device option */
+extern const char *const *xstub_options; /* "Name=value" option overrides, NULL terminated */
+extern int xstub_fd;			/* read end of the open device, -1 if closed */
+extern int xstub_wfd;			/* write end, where the harness puts events */
+extern unsigned int xstub_now;		/* GetTimeInMillis() */
+
+extern int xstub_motion;		/* motion events posted */
+extern int xstub_scrolls;		/* scroll steps posted, on buttons or valuators */
+extern int xstub_presses;		/* key presses and presses of buttons other than 4 to 7 */
+extern int xstub_touches;		/* touch events posted */
+extern int xstub_dx, xstub_dy;		/* relative motion posted, summed up */
+extern unsigned int xstub_first_scroll; /* xstub_now at the first scroll step, 0 before */
+
+/* zero the counts above */
+void xstub_reset(void);
+
+/* fire the timer while it is due at or before until */
+void xstub_run_timers(unsigned int until);
+
+#endif /*XSTUBS_H*/
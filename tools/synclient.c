@@ -37,6 +37,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <stddef.h>
+#include <limits.h>
 #include <math.h>
 
 #include <X11/Xdefs.h>
@@ -124,6 +125,18 @@ static struct Parameter params[] = {
     {"ClickFinger1",          PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_CLICK_ACTION,	8,	0},
     {"ClickFinger2",          PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_CLICK_ACTION,	8,	1},
     {"ClickFinger3",          PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_CLICK_ACTION,	8,	2},
+    {"Swipe3LeftButton",      PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	0},
+    {"Swipe3RightButton",     PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	1},
+    {"Swipe3UpButton",        PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	2},
+    {"Swipe3DownButton",      PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	3},
+    {"Swipe4LeftButton",      PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	4},
+    {"Swipe4RightButton",     PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	5},
+    {"Swipe4UpButton",        PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	6},
+    {"Swipe4DownButton",      PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	7},
+    {"PinchInButton",         PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	8},
+    {"PinchOutButton",        PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	9},
+    {"RotateCWButton",        PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	10},
+    {"RotateCCWButton",       PT_INT,    0, SYN_MAX_BUTTONS, SYNAPTICS_PROP_GESTURE_ACTION,	8,	11},
     {"CircularScrolling",     PT_BOOL,   0, 1,     SYNAPTICS_PROP_CIRCULAR_SCROLLING,	8,	0},
     {"CircScrollDelta",       PT_DOUBLE, .01, 3,   SYNAPTICS_PROP_CIRCULAR_SCROLLING_DIST,	0 /* float */,	0},
     {"CircScrollTrigger",     PT_INT,    0, 8,     SYNAPTICS_PROP_CIRCULAR_SCROLLING_TRIGGER,	8,	0},
@@ -131,8 +144,11 @@ static struct Parameter params[] = {
     {"PalmDetect",            PT_BOOL,   0, 1,     SYNAPTICS_PROP_PALM_DETECT,	8,	0},
     {"PalmMinWidth",          PT_INT,    0, 15,    SYNAPTICS_PROP_PALM_DIMENSIONS,	32,	0},
     {"PalmMinZ",              PT_INT,    0, 255,   SYNAPTICS_PROP_PALM_DIMENSIONS,	32,	1},
+    {"ThumbMinTouchMajor",    PT_INT,    0, 10000, SYNAPTICS_PROP_PALM_TOUCH_MAJOR,	32,	0},
+    {"PalmMinTouchMajor",     PT_INT,    0, 10000, SYNAPTICS_PROP_PALM_TOUCH_MAJOR,	32,	1},
     {"CoastingSpeed",         PT_DOUBLE, 0, 20,    SYNAPTICS_PROP_COASTING_SPEED,	0 /* float*/,	0},
     {"CoastingFriction",      PT_DOUBLE, 0, 255,   SYNAPTICS_PROP_COASTING_SPEED,	0 /* float*/,	1},
+    {"CoastingDecay",         PT_DOUBLE, 0, 10000, SYNAPTICS_PROP_COASTING_DECAY,	0 /* float*/,	0},
     {"PressureMotionMinZ",    PT_INT,    1, 255,   SYNAPTICS_PROP_PRESSURE_MOTION,	32,	0},
     {"PressureMotionMaxZ",    PT_INT,    1, 255,   SYNAPTICS_PROP_PRESSURE_MOTION,	32,	1},
     {"PressureMotionMinFactor", PT_DOUBLE, 0, 10.0,SYNAPTICS_PROP_PRESSURE_MOTION_FACTOR,	0 /*float*/,	0},
@@ -145,6 +161,17 @@ static struct Parameter params[] = {
     {"AreaRightEdge",         PT_INT,    0, 10000, SYNAPTICS_PROP_AREA,	32,	1},
     {"AreaTopEdge",           PT_INT,    0, 10000, SYNAPTICS_PROP_AREA,	32,	2},
     {"AreaBottomEdge",        PT_INT,    0, 10000, SYNAPTICS_PROP_AREA,	32,	3},
+    {"PredictionHorizon",     PT_DOUBLE, 0, 100,   SYNAPTICS_PROP_PREDICTION,	0 /* float */,	0},
+    {"PredictionDamping",     PT_DOUBLE, 0, 0.99,  SYNAPTICS_PROP_PREDICTION,	0 /* float */,	1},
+    {"ResampleRate",          PT_INT,    0, 1000,  SYNAPTICS_PROP_RESAMPLE_RATE,	32,	0},
+    {"RightButtonAreaLeft",   PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	0},
+    {"RightButtonAreaRight",  PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	1},
+    {"RightButtonAreaTop",    PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	2},
+    {"RightButtonAreaBottom", PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	3},
+    {"MiddleButtonAreaLeft",  PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	4},
+    {"MiddleButtonAreaRight", PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	5},
+    {"MiddleButtonAreaTop",   PT_INT,    INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	6},
+    {"MiddleButtonAreaBottom", PT_INT,   INT_MIN, INT_MAX, SYNAPTICS_PROP_SOFTBUTTON_AREAS,	32,	7},
     { NULL, 0, 0, 0, 0 }
 };
 